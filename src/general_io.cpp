@@ -4,6 +4,9 @@
 
 #include "general_io.hpp"
 
+int verbosity_level = 0;
+const double ang_to_bohr = 1e-10 / datum::a_0;  //1.88972612546
+const double Hartree_to_eV = datum::R_inf * datum::h * datum::c_0 / datum::eV * 2; //27.2113860193
 
 void cli_params::parse(int argc, char *argv[]) {
 
@@ -21,6 +24,15 @@ void cli_params::parse(int argc, char *argv[]) {
 		clara::Opt(diff_only)
 		["-d"]["--diff"]
 		("calculate the charge and the potential differences only") |
+		clara::Opt(batch)
+		["-b"]["--batch"]
+		("run the jobs in the sections of the input file with a shared neutral reference") |
+		clara::Opt(serve, "socket")
+		["-s"]["--serve"]
+		("run the JSON jobs which are received on the Unix domain socket (\"stdin\" for the stdin) until a shutdown command") |
+		clara::Opt(trace_file, "trace_file")
+		["-t"]["--trace"]
+		("write the trace events of the calculation steps to a Chrome/Perfetto trace file") |
 		clara::Opt(showManual)
 		["-m"]["--man"]
 		("show the quick start guide") |
@@ -36,6 +48,10 @@ void cli_params::parse(int argc, char *argv[]) {
 		cerr << "Error in command line: " << cli_result.errorMessage() << '\n';
 		exit(1);
 	}
+	if (batch && !serve.empty()) {
+		cerr << "Error in command line: the batch mode and the serve mode cannot be used together" << '\n';
+		exit(1);
+	}
 
 	if (showHelp) {
 		ostringstream oss;
@@ -150,13 +166,77 @@ void prepare_output_file(string& output_file) {
 	}
 }
 
-void initialize_loggers(const string& log_file, const string& output_file) {
+namespace {
+	thread_local vector<string>* thread_messages = nullptr;
+
+	// writes the messages to the slabcc.tmp, or to the messages of the calling thread if they are redirected (redirect_messages)
+	class messages_sink : public spdlog::sinks::base_sink<mutex> {
+	public:
+		explicit messages_sink(const string& file_name) {
+			file.open(file_name, true);
+		}
+
+	protected:
+		void sink_it_(const spdlog::details::log_msg& msg) override {
+			fmt::memory_buffer formatted;
+			formatter_->format(msg, formatted);
+			if (thread_messages) {
+				string message = fmt::to_string(formatted);
+				message.erase(message.find_last_not_of("\r\n") + 1);
+				thread_messages->push_back(message);
+			}
+			else {
+				file.write(formatted);
+			}
+		}
+		void flush_() override {
+			file.flush();
+		}
+
+	private:
+		spdlog::details::file_helper file;
+	};
+
+	// forwards the messages to an asynchronous logger which writes them to the log file in a background thread.
+	// The stdout and the slabcc.tmp sinks remain synchronous: finalize_loggers() reads the slabcc.tmp right after the flush.
+	class async_file_sink : public spdlog::sinks::sink {
+	public:
+		explicit async_file_sink(const string& log_file) {
+			spdlog::init_thread_pool(8192, 1);
+			file_logger = make_shared<spdlog::async_logger>("log_file", make_shared<spdlog::sinks::basic_file_sink_mt>(log_file, true),
+				spdlog::thread_pool(), spdlog::async_overflow_policy::block);
+			file_logger->set_level(spdlog::level::trace);
+		}
+		void log(const spdlog::details::log_msg& msg) override {
+			file_logger->log(msg.level, "{}", string(msg.raw.data(), msg.raw.size()));
+		}
+		void flush() override {
+			file_logger->flush();
+		}
+		void set_pattern(const string& pattern) override {
+			file_logger->set_pattern(pattern);
+		}
+		void set_formatter(unique_ptr<spdlog::formatter> sink_formatter) override {
+			file_logger->set_formatter(move(sink_formatter));
+		}
+
+	private:
+		shared_ptr<spdlog::async_logger> file_logger;
+	};
+}
+
+void initialize_loggers(const string& log_file, const string& output_file, const bool& console_stderr) {
 
 	const string tmp_file = "slabcc.tmp";
 	vector<spdlog::sink_ptr> sinks;
-	sinks.push_back(make_shared<spdlog::sinks::stdout_color_sink_mt>());
-	sinks.push_back(make_shared<spdlog::sinks::basic_file_sink_mt>(log_file, true));
-	sinks.push_back(make_shared<spdlog::sinks::basic_file_sink_mt>(tmp_file, true));
+	if (console_stderr) {
+		sinks.push_back(make_shared<spdlog::sinks::stderr_color_sink_mt>());
+	}
+	else {
+		sinks.push_back(make_shared<spdlog::sinks::stdout_color_sink_mt>());
+	}
+	sinks.push_back(make_shared<async_file_sink>(log_file));
+	sinks.push_back(make_shared<messages_sink>(tmp_file));
 	auto combined_logger = make_shared<spdlog::logger>("loggers", begin(sinks), end(sinks));
 	sinks.at(2)->set_level(spdlog::level::warn);
 	sinks.at(2)->set_pattern("[%l] %v");
@@ -188,6 +268,10 @@ void finalize_loggers() {
 	remove(tmp_file.c_str());
 	output_log->flush();
 }
+void redirect_messages(vector<string>* messages) noexcept {
+	thread_messages = messages;
+}
+
 void update_loggers() {
 
 	auto log = spdlog::get("loggers");
@@ -209,7 +293,10 @@ void update_loggers() {
 	}
 
 	log->set_pattern(log_pattern);
-	log->sinks().at(2)->set_pattern("[%^%l%$] %v");
+	// the messages sink (slabcc.tmp) only exists if the loggers are initialized by the initialize_loggers()
+	if (log->sinks().size() > 2) {
+		log->sinks().at(2)->set_pattern("[%^%l%$] %v");
+	}
 }
 
 string to_string(const bool& b) {
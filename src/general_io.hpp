@@ -10,14 +10,19 @@
 #include "nlopt.hpp"
 #include "sinks/basic_file_sink.h"
 #include "sinks/stdout_color_sinks.h"
+#include "async.h"
+#include <stdexcept>
 
 using namespace std;
 
 extern int verbosity_level;
+extern const double ang_to_bohr;
+extern const double Hartree_to_eV;
 
 struct cli_params {
-	string &input_file, &output_file, &log_file;
-	bool &diff_only;
+	string &input_file, &output_file, &log_file, &trace_file;
+	bool &diff_only, &batch;
+	string &serve;
 
 	// reads the command line and sets the input_file and output_file
 	void parse(int argc, char *argv[]);
@@ -28,6 +33,7 @@ struct cli_params {
 enum class verbosity:int {
 	info = 1,					//spdlog->info()
 	write_normal_planarAvg = 1, //write the planar average of defect and model LOCPOT files
+	write_timing_report = 1,	//write the timing tree of the calculation steps to the output and JSON files
 	debug = 2,					//spdlog->debug()
 	write_defect_file = 2,		//write extra charge density, extra charge potential
 	write_dielectric_file = 2,	//write the dielectric profile of model
@@ -36,6 +42,12 @@ enum class verbosity:int {
 	timing = 4,					//log the time passed from the start of the program
 };
 
+//fatal error of the calculation: the details are logged as critical messages before it is thrown
+class slabcc_error : public runtime_error {
+public:
+	using runtime_error::runtime_error;
+};
+
 //converts the first letter of the string from "a-b-c"/"x-y-z" to 0/1/2
 unsigned int xyz2int(const string& s);
 
@@ -57,10 +69,15 @@ inline bool file_is_empty(ifstream& file) {
 
 string tolower(string in_str) noexcept;
 
-void initialize_loggers(const string& log_file, const string& output_file);
+//the console messages are written to the stderr if the stdout is used for other purposes (serve mode)
+void initialize_loggers(const string& log_file, const string& output_file, const bool& console_stderr = false);
 void update_loggers();
 void finalize_loggers();
 
+//collects the messages of the [Messages] section which are logged in the calling thread in the messages (e.g. for a batch job)
+//the collection stops with redirect_messages(nullptr)
+void redirect_messages(vector<string>* messages) noexcept;
+
 //renames the old output file if possible or choose a new output file name
 void prepare_output_file(string& output_file);
 
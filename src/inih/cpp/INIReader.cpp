@@ -4,7 +4,8 @@
 // Go to the project home page for more info:
 // https://github.com/benhoyt/inih
 
-// NOTE: the "sections" parameter has been removed from the interface functions
+// NOTE: the "sections" parameter has been removed from the interface functions:
+// a section can only be selected as a whole in the constructor (override of the parameters before the first section)
 
 #include "../ini.h"
 #include "INIReader.h"
@@ -13,14 +14,37 @@
 
 using std::string;
 
-INIReader::INIReader(const string& filename) {
+INIReader::INIReader(const string& filename, const string& section) : _section(tolower(section)) {
 	_error = ini_parse(filename.c_str(), ValueHandler, this);
+	select_section();
+}
+
+INIReader INIReader::from_string(const string& contents, const string& section) {
+	INIReader reader;
+	reader._section = tolower(section);
+	reader._error = ini_parse_string(contents.c_str(), ValueHandler, &reader);
+	reader.select_section();
+	return reader;
+}
+
+void INIReader::select_section() {
+	if (_section.empty()) { return; }
+	const string prefix = _section + "=";
+	for (const auto &val : _values) {
+		if (val.first.compare(0, prefix.size(), prefix) == 0) {
+			_values["=" + val.first.substr(prefix.size())] = val.second;
+		}
+	}
 }
 
 int INIReader::ParseError() const noexcept {
 	return _error;
 }
 
+const vector<string>& INIReader::Sections() const noexcept {
+	return _sections;
+}
+
 string INIReader::Get(const string& name, const string default_value) const {
 
 	const string key = "=" + tolower(name);
@@ -132,7 +156,11 @@ void INIReader::dump_parsed() const {
 	}
 	log->info("-----------------------------------------");
 	log->flush();
+	check_parsed();
+}
 
+void INIReader::check_parsed() const {
+	auto log = spdlog::get("loggers");
 	for (const auto &i : _error_msgs) {
 		log->error(i);
 	}
@@ -140,10 +168,12 @@ void INIReader::dump_parsed() const {
 	// add the deprectated parameters here!
 	const vector<string> deprecated_params{"optimize_charge"};
 
+	// only the parameters before the first section or in the requested section are checked
+	const string prefix = _section.empty() ? "=" : _section + "=";
 	for (const auto &val : _values) {
-		string param_in_file = val.first;
-		// get rid of the "=" at the start
-		param_in_file.erase(param_in_file.begin());
+		if (val.first.compare(0, prefix.size(), prefix) != 0) { continue; }
+		// get rid of the "section=" at the start
+		const string param_in_file = val.first.substr(prefix.size());
 		bool has_parsed = false;
 		for (auto const &param_parsed : _parsed) {
 			if (tolower(param_parsed.at(0)) == param_in_file) {
@@ -257,7 +287,11 @@ int INIReader::ValueHandler(void* user, const char* section, const char* name,
 	const char* value)
 {
 	INIReader* reader = static_cast<INIReader*>(user);
-	const string key = "=" + tolower(string(name));
+	const string section_name(section);
+	if (!section_name.empty() && find(reader->_sections.begin(), reader->_sections.end(), section_name) == reader->_sections.end()) {
+		reader->_sections.push_back(section_name);
+	}
+	const string key = tolower(section_name) + "=" + tolower(string(name));
 	if (reader->_values[key].size() > 0)
 		reader->_values[key] += "\n";
 	reader->_values[key] += value;
@@ -21,12 +21,21 @@ class INIReader
 public:
 	// Construct INIReader and parse given filename. See ini.h for more info
 	// about the parsing.
-	INIReader(const std::string& filename);
+	// The parameters in the [section] of the file override the parameters before the first section.
+	// The parameters of the other sections are ignored.
+	INIReader(const std::string& filename, const std::string& section = "");
+
+	// Construct INIReader and parse the contents of an INI file in the string
+	// (e.g. the parameters of a job in the serve mode).
+	static INIReader from_string(const std::string& contents, const std::string& section = "");
 
 	// Return the result of ini_parse(), i.e., 0 on success, line number of
 	// first error on parse error, or -1 on file open error.
 	int ParseError() const noexcept;
 
+	// Return the names of the sections in the file in their order of appearance.
+	const std::vector<std::string>& Sections() const noexcept;
+
 	std::string Get(const std::string& name, const std::string default_value = "") const;
 
 	// Get a string value from INI file, returning default_value if not found.
@@ -56,6 +65,8 @@ public:
 
 	//writes the parsed variables to the output file and also log
 	void dump_parsed() const;
+	//logs the parsing errors and the unrecognized parameters
+	void check_parsed() const;
 	void dump_compilation_info() const;
 	void dump_env_info() const;
 
@@ -66,8 +77,13 @@ protected:
 	mutable std::vector<std::vector<std::string>> _parsed;
 	mutable std::vector<std::string> _error_msgs;
 private:
-	int _error;
+	int _error = 0;
+	std::string _section;
+	std::vector<std::string> _sections;
 	std::map<std::string, std::string> _values;
+	INIReader() = default;
+	// the parameters of the _section override the parameters before the first section
+	void select_section();
 	static int ValueHandler(void* user, const char* section, const char* name,
 		const char* value);
 
@@ -0,0 +1,659 @@
+// Copyright (c) 2018-2019, University of Bremen, M. Farzalipour Tabriz
+// Copyrights licensed under the 2-Clause BSD License.
+// See the accompanying LICENSE.txt file for terms.
+
+#include "slabcc_api.hpp"
+#include "isolated.hpp"
+#include "slabcc_mpi.hpp"
+#include "sinks/null_sink.h"
+#include <mutex>
+#include <condition_variable>
+#include <omp.h>
+
+namespace {
+	// the library functions log to the "loggers" and the "output" loggers of the slabcc
+	// if the host program has not registered them, messages are only written to the console
+	void ensure_loggers() {
+		static mutex loggers_mutex;
+		const lock_guard<mutex> lock(loggers_mutex);
+		if (!spdlog::get("loggers")) {
+			auto console_logger = spdlog::stdout_color_mt("loggers");
+			console_logger->set_pattern("%v");
+			console_logger->set_level(spdlog::level::info);
+		}
+		if (!spdlog::get("output")) {
+			spdlog::create<spdlog::sinks::null_sink_mt>("output");
+		}
+	}
+
+	// error status of an exception
+	// slabcc_errors are logged before they are thrown
+	slabcc_status error_status(const exception& error, const bool& logged) {
+		if (!logged) {
+			spdlog::get("loggers")->critical(error.what());
+		}
+		slabcc_status status;
+		status.success = false;
+		status.error = error.what();
+		return status;
+	}
+
+	// checks if all the input files exist
+	// files: pairs of the parameter name and the file name
+	bool input_files_exist(const vector<pair<string, string>>& files) {
+		auto log = spdlog::get("loggers");
+		bool all_found = true;
+		for (const auto& file : files) {
+			all_found = all_found && file_exists(file.second);
+		}
+		if (!all_found) {
+			for (const auto& file : files) {
+				log->debug("{}: '{}' found: {}", file.first, file.second, to_string(file_exists(file.second)));
+			}
+			log->critical("One or more of the input files could not be found!");
+		}
+		return all_found;
+	}
+}
+
+input_data slabcc_parameters::input_variables() {
+	return {
+		CHGCAR_neutral, LOCPOT_charged, LOCPOT_neutral, CHGCAR_charged,
+		opt_algo, potential_resampling, poisson_solver, charge_position, charge_fraction, charge_sigma, charge_rotations, slabcenter, diel_in, diel_out,
+		normal_direction, interfaces, diel_erf_beta,
+		opt_tol, poisson_tol, optimize, optimize_charge_position, optimize_charge_sigma, optimize_charge_rotation, optimize_charge_fraction, optimize_interfaces, extrapolate, model_2D, charge_trivariate, opt_grid_x,
+		extrapol_grid_x, max_eval, max_time, extrapol_steps_num, extrapol_steps_size, batch_memory, cache_memory };
+}
+
+slabcc_status read_parameters(const string& input_file, slabcc_parameters& parameters) {
+	ensure_loggers();
+	try {
+		const input_data inputfile_variables = parameters.input_variables();
+		inputfile_variables.parse(input_file);
+		if (!input_sections(input_file).empty()) {
+			spdlog::get("loggers")->warn("The parameters in the sections of the input file are only used in the batch mode (--batch)!");
+		}
+		if (!parameters.output_diffs_only) {
+			inputfile_variables.verify();
+		}
+	}
+	catch (const slabcc_error& error) {
+		return error_status(error, true);
+	}
+	catch (const exception& error) {
+		return error_status(error, false);
+	}
+	return {};
+}
+
+slabcc_status verify_parameters(slabcc_parameters& parameters) {
+	ensure_loggers();
+	try {
+		parameters.input_variables().verify();
+	}
+	catch (const slabcc_error& error) {
+		return error_status(error, true);
+	}
+	catch (const exception& error) {
+		return error_status(error, false);
+	}
+	return {};
+}
+
+slabcc_status read_supercells(const slabcc_parameters& parameters, supercell& neutral, supercell& charged) {
+	ensure_loggers();
+	const auto& CHGCAR_neutral = parameters.CHGCAR_neutral;
+	const auto& CHGCAR_charged = parameters.CHGCAR_charged;
+	const auto& LOCPOT_neutral = parameters.LOCPOT_neutral;
+	const auto& LOCPOT_charged = parameters.LOCPOT_charged;
+	if (!input_files_exist({ { "CHGCAR_neutral", CHGCAR_neutral }, { "CHGCAR_charged", CHGCAR_charged },
+		{ "LOCPOT_neutral", LOCPOT_neutral }, { "LOCPOT_charged", LOCPOT_charged } })) {
+		return error_status(slabcc_error("One or more of the input files could not be found!"), true);
+	}
+
+	try {
+		//promises for async read of CHGCAR and POTCAR files
+		vector<future<cube>> future_cells;
+		future_cells.push_back(async(launch::async, read_VASP_grid_data, CHGCAR_neutral));
+		future_cells.push_back(async(launch::async, read_VASP_grid_data, CHGCAR_charged));
+		future_cells.push_back(async(launch::async, read_VASP_grid_data, LOCPOT_neutral));
+		future_cells.push_back(async(launch::async, read_VASP_grid_data, LOCPOT_charged));
+
+		neutral = supercell(CHGCAR_neutral);
+		charged = supercell(CHGCAR_charged);
+
+		neutral.charge = future_cells.at(0).get();
+		charged.charge = future_cells.at(1).get();
+		neutral.potential = future_cells.at(2).get();
+		charged.potential = future_cells.at(3).get();
+	}
+	catch (const slabcc_error& error) {
+		return error_status(error, true);
+	}
+	catch (const exception& error) {
+		return error_status(error, false);
+	}
+	return {};
+}
+
+slabcc_status read_supercell(const string& CHGCAR_file, const string& LOCPOT_file, supercell& cell) {
+	ensure_loggers();
+	if (!input_files_exist({ { "CHGCAR", CHGCAR_file }, { "LOCPOT", LOCPOT_file } })) {
+		return error_status(slabcc_error("One or more of the input files could not be found!"), true);
+	}
+
+	try {
+		future<cube> future_charge = async(launch::async, read_VASP_grid_data, CHGCAR_file);
+		future<cube> future_potential = async(launch::async, read_VASP_grid_data, LOCPOT_file);
+		cell = supercell(CHGCAR_file);
+		cell.charge = future_charge.get();
+		cell.potential = future_potential.get();
+	}
+	catch (const slabcc_error& error) {
+		return error_status(error, true);
+	}
+	catch (const exception& error) {
+		return error_status(error, false);
+	}
+	return {};
+}
+
+slabcc_status read_batch_parameters(const string& input_file, vector<slabcc_job>& jobs, const bool& output_diffs_only) {
+	ensure_loggers();
+	auto log = spdlog::get("loggers");
+	jobs.clear();
+	try {
+		// parameters before the first section
+		slabcc_parameters shared_parameters;
+		shared_parameters.input_variables().parse(input_file);
+
+		for (const auto& section : input_sections(input_file)) {
+			slabcc_job job;
+			job.name = section;
+			job.parameters.output_diffs_only = output_diffs_only;
+			job.parameters.output_id = section + "_";
+			log->debug("Batch job: {}", job.name);
+			redirect_messages(&job.messages);
+			try {
+				const input_data job_variables = job.parameters.input_variables();
+				job_variables.parse(input_file, section);
+				if (!output_diffs_only) {
+					job_variables.verify();
+				}
+			}
+			catch (...) {
+				redirect_messages(nullptr);
+				for (const auto& message : job.messages) {
+					log->debug("{}: {}", job.name, message);
+				}
+				throw;
+			}
+			redirect_messages(nullptr);
+
+			if ((job.parameters.CHGCAR_neutral != shared_parameters.CHGCAR_neutral) || (job.parameters.LOCPOT_neutral != shared_parameters.LOCPOT_neutral)) {
+				log->debug("Neutral files of the batch job {}: {}, {}", job.name, job.parameters.CHGCAR_neutral, job.parameters.LOCPOT_neutral);
+				log->critical("All the batch jobs must have the same neutral files (CHGCAR_neutral, LOCPOT_neutral)!");
+				throw slabcc_error("All the batch jobs must have the same neutral files!");
+			}
+			jobs.push_back(move(job));
+		}
+
+		if (jobs.empty()) {
+			log->critical("No batch jobs have been defined in the input file: {}", input_file);
+			log->critical("Each job must be defined in a section of the input file e.g. [job_name]");
+			throw slabcc_error("No batch jobs have been defined in the input file: " + input_file);
+		}
+	}
+	catch (const slabcc_error& error) {
+		return error_status(error, true);
+	}
+	catch (const exception& error) {
+		return error_status(error, false);
+	}
+	return {};
+}
+
+slabcc_result calculate_correction(const supercell& neutral, const supercell& charged, const slabcc_parameters& parameters,
+	const shared_ptr<resampled_potentials>& resampled_targets) {
+	ensure_loggers();
+	auto log = spdlog::get("loggers");
+	slabcc_result result;
+
+	// the parameters of the extrapolation may be adjusted in the calculation
+	slabcc_parameters local_parameters = parameters;
+	auto& extrapol_steps_num = local_parameters.extrapol_steps_num;
+	auto& extrapol_steps_size = local_parameters.extrapol_steps_size;
+	const auto& normal_direction = local_parameters.normal_direction;
+
+	//promises for async file writing (can be replaced by a deque if the number of files increases)
+	vector<future<void>> future_files;
+
+	try {
+		slabcc_model model;
+		model.set_input_variables(local_parameters.input_variables());
+		model.output_id = local_parameters.output_id;
+		model.POT_target_cache = resampled_targets;
+		const string& output_id = local_parameters.output_id;
+
+		check_slabcc_compatiblity(neutral, charged);
+
+		//cell vectors of the CHGCAR and LOCPOT files (bohr)
+		const mat33 input_cell_vectors = abs(neutral.cell_vectors) * neutral.scaling * ang_to_bohr;
+		const urowvec3 input_grid_size = SizeVec(neutral.charge);
+		model.init_supercell(input_cell_vectors, input_grid_size);
+
+		const rowvec3 relative_shift = 0.5 - local_parameters.slabcenter;
+		model.rounded_relative_shift = round(model.cell_grid % relative_shift) / model.cell_grid;
+
+		model.interfaces = fmod(model.interfaces + model.rounded_relative_shift(normal_direction), 1);
+
+		// the model parameters are centered but the input grids are not moved:
+		// the model grids are generated with the same origin as the input grids
+		model.charge_position += repmat(model.rounded_relative_shift, model.charge_position.n_rows, 1);
+		model.charge_position = fmod_p(model.charge_position, 1);
+		model.grid_offset = model.rounded_relative_shift;
+		log->debug("Slab normal direction index (0-2): {}", model.normal_direction);
+		log->trace("Shift to center done!");
+
+		supercell Defect_supercell = neutral;
+		Defect_supercell.potential = charged.potential - neutral.potential;
+		Defect_supercell.charge = charged.charge - neutral.charge;
+
+		if (is_active(verbosity::write_defect_file) || local_parameters.output_diffs_only) {
+			future_files.push_back(async(launch::async, &supercell::write_LOCPOT, Defect_supercell, "slabcc_" + output_id + "D.LOCPOT"));
+			future_files.push_back(async(launch::async, &supercell::write_CHGCAR, Defect_supercell, "slabcc_" + output_id + "D.CHGCAR"));
+		}
+
+		//normalize the charges and potentials
+		Defect_supercell.charge *= -1.0 / model.cell_volume;
+		Defect_supercell.potential *= -1.0;
+		model.POT_target_on_input_grid = Defect_supercell.potential;
+
+		if (local_parameters.output_diffs_only) {
+			log->debug("Only the extra charge and the potential difference calculation have been requested!");
+			write_planar_avg(Defect_supercell.potential, Defect_supercell.charge * model.voxel_vol, output_id + "D", model.cell_vectors_lengths);
+			for (auto& promise : future_files) { promise.get(); }
+			return result;
+		}
+
+		if (is_active(verbosity::write_planarAvg_file)) {
+			write_planar_avg(neutral.potential, cube(neutral.charge * (-1.0 / model.cell_volume)) * model.voxel_vol, output_id + "N", model.cell_vectors_lengths);
+			write_planar_avg(charged.potential, cube(charged.charge * (-1.0 / model.cell_volume)) * model.voxel_vol, output_id + "C", model.cell_vectors_lengths);
+			write_planar_avg(Defect_supercell.potential, Defect_supercell.charge * model.voxel_vol, output_id + "D", model.cell_vectors_lengths);
+		}
+
+		// total extra charge of the VASP calculation
+		model.defect_charge = accu(Defect_supercell.charge) * model.voxel_vol;
+
+		if (abs(model.defect_charge) < 0.001) {
+			log->debug("Total extra charge: {}", model.defect_charge);
+			log->warn("Total extra charge seems to be very small. Please make sure the path to the input CHGCAR files are set properly!");
+		}
+		const opt_switches optimizer_activation_switches{ local_parameters.optimize_charge_position, local_parameters.optimize_charge_sigma,
+			local_parameters.optimize_charge_rotation, local_parameters.optimize_charge_fraction, local_parameters.optimize_interfaces };
+		const bool optimize_any = optimizer_activation_switches.charge_position || optimizer_activation_switches.charge_sigma
+			|| optimizer_activation_switches.charge_rotation || optimizer_activation_switches.charge_fraction || optimizer_activation_switches.interfaces;
+
+		if (optimize_any) {
+			const rowvec2 shifted_interfaces0 = model.interfaces;
+			const mat charge_position0 = model.charge_position;
+			const urowvec3 cell_grid0 = model.cell_grid;
+			const rowvec3 optimization_grid_size = local_parameters.opt_grid_x * conv_to<rowvec>::from(model.cell_grid);
+			const urowvec3 optimization_grid = { (uword)optimization_grid_size(0), (uword)optimization_grid_size(1), (uword)optimization_grid_size(2) };
+			model.change_grid(optimization_grid);
+			model.update_V_target();
+			model.optimize(local_parameters.opt_algo, local_parameters.opt_tol, local_parameters.max_eval, local_parameters.max_time, optimizer_activation_switches);
+
+			//unshifted optimized values
+			if (optimizer_activation_switches.interfaces) {
+				const rowvec2 optimized_interfaces = fmod_p(model.interfaces - model.rounded_relative_shift(model.normal_direction), 1);
+				result.optimized_parameters.emplace_back("interfaces_optimized", to_string(optimized_interfaces));
+			}
+
+			if (optimizer_activation_switches.charge_fraction) {
+				result.optimized_parameters.emplace_back("charge_fraction_optimized", to_string(model.charge_fraction));
+			}
+			if (optimizer_activation_switches.charge_sigma) {
+				const mat opt_charge_sigma = model.trivariate_charge ? model.charge_sigma : model.charge_sigma.col(0);
+				result.optimized_parameters.emplace_back("charge_sigma_optimized", to_string(opt_charge_sigma));
+				model.verify_charge_optimization();
+
+			}
+			if (optimizer_activation_switches.charge_rotation) {
+				const mat rotations = model.charge_rotations * 180.0 / PI;
+				result.optimized_parameters.emplace_back("charge_rotation_optimized", to_string(rotations));
+			}
+			if (optimizer_activation_switches.charge_position) {
+				const mat optimized_charge_position = fmod_p(model.charge_position - repmat(model.rounded_relative_shift, model.charge_position.n_rows, 1), 1);
+				result.optimized_parameters.emplace_back("charge_position_optimized", to_string(optimized_charge_position));
+
+				// TODO: need a better algorithm to handle the swaps and PBCs similar to verify_interface_optimization()
+				const mat charge_position_change = abs(charge_position0 - model.charge_position);
+				if (charge_position_change.max() > 0.1) {
+					log->warn("The optimized position for the extra charge is significantly different from the initial value. "
+						"Please make sure that the final position of the extra charge have been estimated correctly!");
+					log->debug("Charge position changes: ", to_string(charge_position_change));
+				}
+			}
+
+			if (optimizer_activation_switches.interfaces) {
+				model.verify_interface_optimization(shifted_interfaces0);
+			}
+
+			if (model.initial_potential_RMSE * (local_parameters.opt_tol + 1) < model.potential_RMSE) {
+				// Don't panic! either NLOPT seems to be malfunctioning
+				// or we are not correctly logging/checking the result
+				log->critical("Optimization failed!");
+				log->critical("Potential error of the initial parameters seems to be smaller than the optimized parameters! "
+					"You may want to change the initial guess for charge_position, change the optimization algorithm, or turn off the optimization.");
+				log->debug("Initial model potential RMSE: {}", model.initial_potential_RMSE);
+				log->debug("Optimized model potential RMSE: {}", model.potential_RMSE);
+				throw slabcc_error("Optimization failed!");
+			}
+			if (cell_grid0(0) > model.cell_grid(0)) {
+				model.change_grid(cell_grid0);
+				model.update_V_target();
+			}
+		}
+
+		//unshifted model parameters
+		result.interfaces = fmod_p(model.interfaces - model.rounded_relative_shift(model.normal_direction), 1);
+		result.charge_position = fmod_p(model.charge_position - repmat(model.rounded_relative_shift, model.charge_position.n_rows, 1), 1);
+		result.charge_sigma = model.charge_sigma;
+		result.charge_rotations = model.charge_rotations * 180.0 / PI;
+		result.charge_fraction = model.charge_fraction;
+
+		auto local_param = model.data_packer();
+		vector<double> gradients = {};
+		model.potential_RMSE = potential_error(get<0>(local_param), gradients, &model);
+		model.check_V_error();
+		result.potential_RMSE = model.potential_RMSE;
+
+		log->debug("Cell dimensions (bohr): " + to_string(model.cell_vectors_lengths));
+		log->debug("Volume (bohr^3): {}", model.cell_volume);
+
+
+		if (is_active(verbosity::write_defect_file)) {
+			supercell Model_supercell = neutral;
+			//charge is normalized to the VASP CHGCAR convention (rho * Vol)
+			//Also, positive value for the electron charge! (the probability of finding an electron)
+			Model_supercell.charge = -real(model.CHG) * model.voxel_vol * model.CHG.n_elem;
+			Model_supercell.potential = -real(model.POT) * Hartree_to_eV;
+			future_files.push_back(async(launch::async, &supercell::write_CHGCAR, Model_supercell, "slabcc_" + output_id + "M.CHGCAR"));
+			future_files.push_back(async(launch::async, &supercell::write_LOCPOT, Model_supercell, "slabcc_" + output_id + "M.LOCPOT"));
+		}
+
+		if (is_active(verbosity::write_dielectric_file)) {
+			model.dielectric_profiles.save("slabcc_" + output_id + "DIEL.dat", raw_ascii);
+		}
+		if (is_active(verbosity::write_planarAvg_file)) {
+			write_planar_avg(real(model.POT) * Hartree_to_eV, real(model.CHG) * model.voxel_vol, output_id + "M", model.cell_vectors_lengths);
+		}
+		else if (is_active(verbosity::write_normal_planarAvg)) {
+			write_planar_avg(real(model.POT) * Hartree_to_eV, real(model.CHG) * model.voxel_vol, output_id + "M", model.cell_vectors_lengths, model.normal_direction);
+		}
+
+		model.verify_CHG(Defect_supercell.charge);
+
+		//add jellium to the charge (Because the V is normalized, it is not needed in solving the Poisson eq. but it is needed in the energy calculations)
+		model.CHG -= model.total_charge / model.cell_volume;
+
+		const uword farthest_element_index = model.total_charge < 0 ? real(model.POT).index_max() : real(model.POT).index_min();
+
+		const auto dV = model.POT_diff(farthest_element_index);
+		log->info("Potential alignment (dV=): {}", ::to_string(dV));
+		result.results.emplace_back("dV", ::to_string(dV));
+		result.dV = dV;
+		const bool isotropic_screening = accu(abs(diff(local_parameters.diel_in))) < 0.02;
+		if (abs(dV) > 0.05) {
+			if (model.type == model_type::bulk && isotropic_screening) {
+				log->debug("The potential alignment term (dV) is relatively large. But in the isotropic bulk models "
+					"this should not make much difference in the total energy correction value!");
+			}
+			else {
+				log->warn("The potential alignment term (dV) is relatively large. The constructed model may not be accurate!");
+			}
+		}
+
+		log->debug("Calculation grid point for the potential alignment term: {}", to_string(ind2sub(as_size(model.cell_grid), farthest_element_index)));
+
+		const double EperModel0 = 0.5 * accu(real(model.POT) % real(model.CHG)) * model.voxel_vol * Hartree_to_eV;
+		log->info("E_periodic of the model charge: {}", ::to_string(EperModel0));
+		result.results.emplace_back("E_periodic of the model charge", ::to_string(EperModel0));
+		result.E_periodic = EperModel0;
+
+		log->debug("Difference of the charge in the input files: {}", ::to_string(model.defect_charge));
+		log->debug("Total charge of the model: {}", ::to_string(model.total_charge));
+
+		double E_isolated = 0;
+		double E_correction = 0;
+
+		// the isolated energy is calculated in the centered coordinates (the slab must not cross the cell boundaries)
+		model.grid_offset.zeros();
+		model.dielectric_profiles_gen();
+
+		if (local_parameters.extrapolate) {
+
+			const rowvec3 extrapolation_grid_size = local_parameters.extrapol_grid_x * conv_to<rowvec>::from(model.cell_grid);
+			const urowvec3 extrapolation_grid = { (uword)extrapolation_grid_size(0), (uword)extrapolation_grid_size(1), (uword)extrapolation_grid_size(2) };
+			model.change_grid(extrapolation_grid);
+			model.adjust_extrapolation_grid(extrapol_steps_num, extrapol_steps_size);
+			if (as_size(model.cell_grid) != as_size(extrapolation_grid)) { //discretization error has been detected
+				if (model.type != model_type::monolayer) {
+					string adjusted_parameters = "";
+					if (extrapol_steps_num > 4) {
+						extrapol_steps_num = 4;
+						adjusted_parameters += " extrapolate_steps_number=" + to_string(extrapol_steps_num);
+					}
+					if (extrapol_steps_size > 0.25) {
+						extrapol_steps_size = 0.25;
+						adjusted_parameters += " extrapolate_steps_size=" + to_string(extrapol_steps_size);
+					}
+					if (adjusted_parameters != "") {
+						log->debug("Adjusted parameters:{}", adjusted_parameters);
+						model.change_grid(extrapolation_grid);
+						model.adjust_extrapolation_grid(extrapol_steps_num, extrapol_steps_size);
+					}
+				}
+			}
+
+			log->debug("--------------------------------------------------------");
+			log->debug("Scaling\tE_periodic\t\tmodel charge\t\tinterfaces\t\tcharge position");
+			if (log->should_log(spdlog::level::debug)) {
+				const rowvec2 interface_pos = model.interfaces * model.cell_vectors_lengths(model.normal_direction);
+				string extrapolation_info = to_string(1.0) + "\t" + ::to_string(EperModel0) + "\t" + ::to_string(model.total_charge) + "\t" + to_string(interface_pos);
+				for (uword i = 0; i < model.charge_position.n_rows; ++i) {
+					extrapolation_info += "\t" + to_string(model.charge_position(i, model.normal_direction) * model.cell_vectors_lengths(model.normal_direction));
+				}
+				log->debug(extrapolation_info);
+			}
+			rowvec Es = zeros<rowvec>(extrapol_steps_num - 1), sizes = Es;
+			tie(Es, sizes) = model.extrapolate(extrapol_steps_num, extrapol_steps_size);
+
+			if (model.type == model_type::monolayer) {
+				const rowvec3 unit_cell = model.cell_vectors_lengths / max(model.cell_vectors_lengths);
+				const auto radius = 10.0;
+				const auto ewald_shells = generate_shells(unit_cell, radius);
+				const auto madelung_const = jellium_madelung_constant(ewald_shells, unit_cell, 1);
+				auto madelung_term = -pow(model.total_charge, 2) * madelung_const / 2;
+				nonlinear_fit_data fit_data = { Es ,sizes, madelung_term };
+				const auto cs = nonlinear_fit(1e-10, fit_data);
+
+				log->info("Madelung constant = " + ::to_string(madelung_const));
+				const string fit_params = "c0= " + ::to_string(cs.at(0)) +
+					", c1=" + ::to_string(cs.at(1)) +
+					", c2=" + ::to_string(cs.at(2)) +
+					", c3=" + ::to_string(cs.at(3));
+				log->info("Non-linear fit parameters:" + fit_params);
+				result.results.emplace_back("Non-linear fit parameters", fit_params);
+				result.results.emplace_back("Madelung constant", ::to_string(madelung_const));
+
+				E_isolated = cs.at(0) + (cs.at(1) - madelung_term) / cs.at(3);
+				E_correction = E_isolated - EperModel0 - model.total_charge * dV;
+			}
+			else { // bulk and slab models
+				const colvec pols = polyfit(sizes, Es, 1);
+				const colvec evals = polyval(pols, sizes.t());
+				const auto linearfit_MSE = accu(square(evals.t() - Es)) / Es.n_elem * 100;
+				const rowvec slopes = diff(Es) / diff(sizes);
+				const auto extrapol_error_periodic = abs(slopes(0) - slopes(slopes.n_elem - 1));
+				log->debug("--------------------------------------------------------");
+				log->debug("Linear fit: Eper(Model) = {}/scaling + {}", ::to_string(pols(0)), ::to_string(pols(1)));
+				log->debug("Linear fit Root Mean Square Error: {}", ::to_string(sqrt(linearfit_MSE)));
+				log->debug("Polyfit evaluated energies: {}", ::to_string(evals));
+				log->debug("Linear fit error for the periodic model: {}", ::to_string(extrapol_error_periodic));
+
+				if (extrapol_error_periodic > 0.05) {
+					log->debug("Extrapolation energy slopes: {}", to_string(slopes));
+					log->critical("The extrapolated energies are not scaling linearly as expected!");
+					if (model.type != model_type::bulk) {
+						log->critical("The slab thickness may be too small for this extrapolation algorithm. "
+							"For calculating the charge correction energy for the 2D models use \"2D_model = yes\" in the input file.");
+					}
+					throw slabcc_error("The extrapolated energies are not scaling linearly as expected!");
+				}
+
+				E_isolated = EperModel0 - pols(0);
+				E_correction = -pols(0) - model.total_charge * dV;
+
+			}
+			log->info("E_isolated from extrapolation with {}x{} steps: {}", to_string(extrapol_steps_num), to_string(extrapol_steps_size), ::to_string(E_isolated));
+		}
+		else {
+			if (model.type == model_type::monolayer) {
+				E_isolated = model.Eiso_bessel();
+				E_correction = E_isolated - EperModel0 - model.total_charge * dV;
+				log->info("E_isolated from the Bessel expansion of the Poisson equation: {}", ::to_string(E_isolated));
+			}
+			else {
+				// input parameter checking function must prevent this from happening!
+				log->critical("There is no algorithm other than the extrapolation for E_isolated calculation of the slab models in this version of the slabcc!");
+				throw slabcc_error("There is no algorithm other than the extrapolation for E_isolated calculation of the slab models in this version of the slabcc!");
+			}
+
+		}
+		result.results.emplace_back("E_isolated of the model charge", ::to_string(E_isolated));
+		result.E_isolated = E_isolated;
+
+		log->info("Energy correction for the model charge (E_iso-E_per-q*dV=): {}", ::to_string(E_correction));
+		result.results.emplace_back("Energy correction for the model charge (E_iso-E_per-q*dV)", ::to_string(E_correction));
+		result.E_correction = E_correction;
+		log->flush();
+
+		//making sure all the files are written
+		for (auto& promise : future_files) { promise.get(); }
+	}
+	catch (const slabcc_error& error) {
+		result.status = error_status(error, true);
+	}
+	catch (const exception& error) {
+		result.status = error_status(error, false);
+	}
+
+	return result;
+}
+
+vector<slabcc_result> calculate_batch(const supercell& neutral, const vector<slabcc_job>& jobs) {
+	ensure_loggers();
+	const scoped_timer timer("calculate_batch");
+	auto log = spdlog::get("loggers");
+	vector<slabcc_result> results(jobs.size());
+	if (jobs.empty()) { return results; }
+
+	// estimated memory (bytes) of the charged supercell of a job and of its whole calculation
+	// (input grids, the differences, the model grids, and the temporary grids of the Poisson solvers)
+	const double grid_memory = sizeof(double) * static_cast<double>(neutral.charge.n_elem);
+	const double load_memory = 2 * grid_memory;
+	const double job_memory = 24 * grid_memory;
+	const double memory_budget = jobs.front().parameters.batch_memory * 1e9;
+
+	const int threads = omp_get_max_threads();
+	size_t max_running = static_cast<size_t>(memory_budget / job_memory);
+	max_running = std::max<size_t>(1, std::min({ max_running, static_cast<size_t>(threads), jobs.size() }));
+#ifdef SLABCC_MPI
+	// the distributed Poisson solves are only called from the main thread
+	if (mpi_ranks() > 1) { max_running = 1; }
+#endif
+	const int job_threads = std::max(1, threads / static_cast<int>(max_running));
+	log->debug("Batch jobs: {}, concurrent jobs: {}, OpenMP threads per job: {}", jobs.size(), max_running, job_threads);
+	log->debug("Estimated memory per job: {} GB", job_memory / 1e9);
+
+	mutex batch_mutex;
+	condition_variable batch_changed;
+	double reserved_memory = 0;
+	size_t loaded_jobs = 0, running_jobs = 0;
+
+	vector<supercell> charged(jobs.size());
+	vector<slabcc_status> read_status(jobs.size());
+	vector<vector<string>> messages(jobs.size());
+	for (size_t i = 0; i < jobs.size(); ++i) {
+		messages.at(i) = jobs.at(i).messages;
+	}
+
+	// reads the charged supercells in the order of the jobs, ahead of their calculations
+	auto reader = async(launch::async, [&]() {
+		for (size_t i = 0; i < jobs.size(); ++i) {
+			{
+				unique_lock<mutex> lock(batch_mutex);
+				batch_changed.wait(lock, [&]() { return (reserved_memory == 0) || (reserved_memory + load_memory <= memory_budget); });
+				reserved_memory += load_memory;
+			}
+			redirect_messages(&messages.at(i));
+			read_status.at(i) = read_supercell(jobs.at(i).parameters.CHGCAR_charged, jobs.at(i).parameters.LOCPOT_charged, charged.at(i));
+			redirect_messages(nullptr);
+			{
+				const lock_guard<mutex> lock(batch_mutex);
+				++loaded_jobs;
+			}
+			batch_changed.notify_all();
+		}
+	});
+
+	const auto run_job = [&](const size_t& i) {
+		redirect_messages(&messages.at(i));
+		omp_set_num_threads(job_threads);
+		log->info("Batch job: {}", jobs.at(i).name);
+		if (read_status.at(i)) {
+			results.at(i) = calculate_correction(neutral, charged.at(i), jobs.at(i).parameters);
+		}
+		else {
+			results.at(i).status = read_status.at(i);
+		}
+		charged.at(i) = supercell();
+		redirect_messages(nullptr);
+		{
+			const lock_guard<mutex> lock(batch_mutex);
+			reserved_memory -= job_memory;
+			--running_jobs;
+		}
+		batch_changed.notify_all();
+	};
+
+	vector<future<void>> calculations;
+	for (size_t i = 0; i < jobs.size(); ++i) {
+		{
+			// a job is always started if nothing else is running, even if its memory exceeds the budget
+			unique_lock<mutex> lock(batch_mutex);
+			batch_changed.wait(lock, [&]() {
+				return (loaded_jobs > i) && (running_jobs < max_running)
+					&& ((running_jobs == 0) || (reserved_memory + job_memory - load_memory <= memory_budget));
+			});
+			reserved_memory += job_memory - load_memory;
+			++running_jobs;
+		}
+		if (max_running == 1) {
+			run_job(i);
+		}
+		else {
+			calculations.push_back(async(launch::async, run_job, i));
+		}
+	}
+	for (auto& calculation : calculations) { calculation.get(); }
+	reader.get();
+	omp_set_num_threads(threads);
+
+	for (size_t i = 0; i < jobs.size(); ++i) {
+		results.at(i).messages = move(messages.at(i));
+	}
+	return results;
+}
@@ -0,0 +1,132 @@
+// Copyright (c) 2018-2019, University of Bremen, M. Farzalipour Tabriz
+// Copyrights licensed under the 2-Clause BSD License.
+// See the accompanying LICENSE.txt file for terms.
+
+#pragma once
+#include "slabcc_model.hpp"
+
+// C++ API of the slabcc library (libslabcc):
+// The charge correction is calculated from the in-memory supercells of the neutral and the charged systems and the parameters.
+// The functions do not exit the process. Errors are returned in the slabcc_status and the details are logged as usual.
+// If the host program has not initialized the loggers (initialize_loggers), a console logger is created.
+// Files are only written with the verbosity levels of the slabcc (verbosity_level).
+
+// parameters of the charge correction (slabcc input file parameters)
+// default values are defined in the input_data::parse
+struct slabcc_parameters {
+	string CHGCAR_neutral = "";
+	string LOCPOT_neutral = "";
+	string LOCPOT_charged = "";
+	string CHGCAR_charged = "";
+	string opt_algo = "";				//optimization algorithm
+	string potential_resampling = "";	//resampling method of the target potential on the model grids
+	string poisson_solver = "";			//solver of the linear systems of the Poisson equation
+	mat charge_position;				//center of each Gaussian model charge
+	rowvec charge_fraction;				//charge fraction in each Gaussian
+	mat charge_sigma;					//width of each Gaussian model charges
+	mat charge_rotations;				//rotation angles along each axis for the trivariate Gaussians
+	bool charge_trivariate = false;		//use trivariate Gaussians
+	rowvec diel_in;						//diagonal elements of slab dielectric tensor
+	rowvec diel_out;					//diagonal elements of enviroment dielectric tensor
+	rowvec3 slabcenter;
+	uword normal_direction = 0;			//index of the normal direction (0/1/2)
+	rowvec2 interfaces;					//interfaces in relative coordinates, ordered as the user input
+	double diel_erf_beta = 0;			//beta value of the erf for dielectric profile generation
+	double opt_tol = 0;					//relative optimization tolerance
+	double poisson_tol = 0;				//tolerance of the Poisson solver
+	double extrapol_grid_x = 0;			//extrapolation grid size multiplier
+	double opt_grid_x = 0;				//optimization grid size multiplier
+	int max_eval = 0;					//maximum number of steps for the optimization function evaluation
+	int max_time = 0;					//maximum time for the optimization in minutes
+	int extrapol_steps_num = 0;			//number of extrapolation steps for E-isolated calculation
+	double extrapol_steps_size = 0;		//size of each extrapolation step with respect to the initial supercell size
+	bool optimize = false;					//optimizer master switch. Overrides the others if this one is disabled!
+	bool optimize_charge_position = false;	//optimize the charge_position
+	bool optimize_charge_sigma = false;		//optimize the charge_sigma
+	bool optimize_charge_rotation = false;	//optimize the charge_rotation
+	bool optimize_charge_fraction = false;	//optimize the charge_fraction
+	bool optimize_interfaces = false;		//optimize the position of interfaces
+	bool extrapolate = false;			//use the extrapolation for E-isolated calculations
+	bool model_2D = false;				//the model is 2D
+	double batch_memory = 0;			//memory for the concurrent batch jobs (GB)
+	double cache_memory = 0;			//memory for the supercells and the resampled potentials which are kept between the serve mode jobs (GB)
+	bool output_diffs_only = false;		//only calculate and write the extra charge and the potential difference
+	string output_id = "";				//added to the names of the written files after the "slabcc_" (e.g. name of a batch job)
+
+	// references to the parameters for the input file parser and the sanity checks
+	input_data input_variables();
+};
+
+// success or the error message of a library call
+struct slabcc_status {
+	bool success = true;
+	string error = "";
+
+	explicit operator bool() const noexcept { return success; }
+};
+
+struct slabcc_result {
+	slabcc_status status;
+
+	// energies (eV)
+	double dV = 0;
+	double E_periodic = 0;
+	double E_isolated = 0;
+	double E_correction = 0;
+
+	// root mean squared error of the model potential (eV)
+	double potential_RMSE = 0;
+
+	// model parameters after the optimization (unshifted)
+	rowvec2 interfaces = { 0, 0 };
+	mat charge_position, charge_sigma, charge_rotations;
+	rowvec charge_fraction;
+
+	// "[Optimized_model_parameters]" and "[Results]" sections of the slabcc output file
+	vector<pair<string, string>> optimized_parameters, results;
+
+	// warning and error messages of a batch job (calculate_batch)
+	vector<string> messages;
+};
+
+// a job of the batch mode: a charged system with its own model parameters
+struct slabcc_job {
+	string name;
+	slabcc_parameters parameters;
+
+	// warning and error messages of reading the parameters
+	vector<string> messages;
+};
+
+// reads the parameters from the slabcc input file (missing parameters get their default values)
+// the parameters are also verified unless the parameters.output_diffs_only is set
+slabcc_status read_parameters(const string& input_file, slabcc_parameters& parameters);
+
+// sanity checks on the parameters (needed after changing the parameters which are read by the read_parameters)
+slabcc_status verify_parameters(slabcc_parameters& parameters);
+
+// reads the CHGCAR and LOCPOT files of the parameters
+slabcc_status read_supercells(const slabcc_parameters& parameters, supercell& neutral, supercell& charged);
+
+// reads a CHGCAR and a LOCPOT file of the same system
+slabcc_status read_supercell(const string& CHGCAR_file, const string& LOCPOT_file, supercell& cell);
+
+// reads the jobs of a batch input file: each [section] of the file defines a job with the name of the section.
+// The parameters of a section override the parameters which are defined before the first section.
+// All the jobs must have the same neutral files (CHGCAR_neutral, LOCPOT_neutral).
+// The parameters of the jobs are verified unless the output_diffs_only is set.
+slabcc_status read_batch_parameters(const string& input_file, vector<slabcc_job>& jobs, const bool& output_diffs_only = false);
+
+// charge correction of the charged supercell with the neutral supercell as its reference
+// parameters must be verified before
+// resampled_targets (optional): the target potentials of the previous calculations with the same supercells are reused
+// and the new ones are added to it
+slabcc_result calculate_correction(const supercell& neutral, const supercell& charged, const slabcc_parameters& parameters,
+	const shared_ptr<resampled_potentials>& resampled_targets = nullptr);
+
+// charge corrections of the batch jobs with the neutral supercell as their shared reference
+// The charged supercells are read in a background thread ahead of their calculations and the calculations
+// run concurrently, as long as their estimated memory fits in the batch_memory of the first job.
+// The OpenMP threads are divided between the concurrent calculations.
+// returns the results in the order of the jobs
+vector<slabcc_result> calculate_batch(const supercell& neutral, const vector<slabcc_job>& jobs);
@@ -0,0 +1,238 @@
+// Copyright (c) 2018-2019, University of Bremen, M. Farzalipour Tabriz
+// Copyrights licensed under the 2-Clause BSD License.
+// See the accompanying LICENSE.txt file for terms.
+
+// Micro-benchmarks for the numerical kernels of the slabcc
+// Results are written as JSON to track the performance changes between the versions:
+// time (s) of the fastest and the average repetition, processed elements per second, and the memory throughput (GB/s)
+// The memory throughput is estimated from the minimum amount of data each kernel must read and write.
+
+#include "stdafx.h"
+#include "slabcc_model.hpp"
+#include <omp.h>
+
+using namespace std;
+
+struct benchmark_result {
+	string kernel;
+	urowvec3 grid;
+	double elements = 0;	// number of processed elements (voxels, grid points, ...)
+	double bytes = 0;		// minimum memory traffic of one kernel call
+	vec times;				// wall time of each repetition (s)
+};
+
+// runs the kernel once for warming up and then "repeat" times and records the wall times
+template <typename F>
+benchmark_result run_benchmark(const string& kernel_name, const urowvec3& grid, const double& elements, const double& bytes, const int& repeat, F&& kernel) {
+	auto log = spdlog::get("loggers");
+	benchmark_result result = { kernel_name, grid, elements, bytes, vec(repeat) };
+	kernel();
+	for (int i = 0; i < repeat; ++i) {
+		const auto start = chrono::steady_clock::now();
+		kernel();
+		result.times(i) = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	}
+	const string grid_size = to_string(grid(0)) + "x" + to_string(grid(1)) + "x" + to_string(grid(2));
+	log->info("{:<28} {:>14} {:>12.6f} s {:>12.4e} elem/s {:>9.3f} GB/s", kernel_name, grid_size,
+		min(result.times), elements / min(result.times), bytes / min(result.times) / 1e9);
+	return result;
+}
+
+// slab model with a single Gaussian charge in a 10x10x20 Ang supercell
+slabcc_model benchmark_model(const urowvec3& grid) {
+	slabcc_model model;
+	const mat33 cell_vectors = diagmat(rowvec3{ 10, 10, 20 }) * ang_to_bohr;
+	model.init_supercell(cell_vectors, grid);
+	model.normal_direction = 2;
+	model.type = model_type::slab;
+	model.interfaces = { 0.25, 0.75 };
+	model.diel_in = { 4, 4, 6 };
+	model.diel_out = { 1, 1, 1 };
+	model.diel_erf_beta = 1;
+	model.charge_position = { 0.5, 0.5, 0.6 };
+	model.charge_sigma = { 1.5, 1.5, 1.5 };
+	model.charge_rotations = zeros(1, 3);
+	model.charge_fraction = { 1 };
+	model.defect_charge = -1;
+	// no discretization error checks and no target potential regrids
+	model.in_optimization = true;
+	model.POT_target = zeros(as_size(grid));
+	return model;
+}
+
+vector<benchmark_result> benchmark_grid(const urowvec3& grid, const int& repeat) {
+	vector<benchmark_result> results;
+	const double n_elem = prod(conv_to<rowvec>::from(grid));
+	const double real_size = sizeof(double) * n_elem;
+	const double complex_size = sizeof(cx_double) * n_elem;
+
+	slabcc_model model = benchmark_model(grid);
+	model.gaussian_charges_gen();
+	model.dielectric_profiles_gen();
+	const cube data = real(model.CHG);
+	cx_cube V;
+
+	results.push_back(run_benchmark("poisson_solver_3D", grid, n_elem, 2 * complex_size, repeat, [&]() {
+		V = poisson_solver_3D(model.CHG, model.dielectric_profiles, model.cell_vectors_lengths, model.normal_direction);
+	}));
+
+	// batched solve for the separate densities of a multi-Gaussian model
+	const vector<cx_cube> densities(4, model.CHG);
+	vector<cx_cube> potentials;
+	results.push_back(run_benchmark("poisson_solver_3D (batch 4)", grid, 4 * n_elem, 8 * complex_size, repeat, [&]() {
+		potentials = poisson_solver_3D(densities, model.dielectric_profiles, model.cell_vectors_lengths, model.normal_direction);
+	}));
+
+	// finite-difference solve from a zero initial potential
+	results.push_back(run_benchmark("poisson_solver_multigrid", grid, n_elem, 2 * complex_size, repeat, [&]() {
+		V = poisson_solver_multigrid(model.CHG, model.dielectric_profiles, model.cell_vectors_lengths, model.normal_direction, 1e-6, cx_cube());
+	}));
+
+	cx_cube data_k;
+	results.push_back(run_benchmark("fft (real cube)", grid, n_elem, real_size + complex_size, repeat, [&]() {
+		data_k = fft(data);
+	}));
+
+	results.push_back(run_benchmark("fft (complex cube)", grid, n_elem, 2 * complex_size, repeat, [&]() {
+		data_k = fft(model.CHG);
+	}));
+
+	results.push_back(run_benchmark("ifft (complex cube)", grid, n_elem, 2 * complex_size, repeat, [&]() {
+		V = ifft(data_k);
+	}));
+
+	cube shifted;
+	results.push_back(run_benchmark("shift", grid, n_elem, 2 * real_size, repeat, [&]() {
+		shifted = shift(data, rowvec3{ 0.25, 0.5, 0.75 });
+	}));
+
+	const rowvec xi = linspace<rowvec>(1, grid(0), grid(0));
+	const rowvec yi = linspace<rowvec>(1, grid(1), grid(1));
+	const rowvec zi = linspace<rowvec>(1, grid(2), grid(2));
+	cube interpolated;
+	results.push_back(run_benchmark("interp3", grid, n_elem, 6 * real_size, repeat, [&]() {
+		interpolated = interp3(data, xi, yi, zi);
+	}));
+
+	vec average;
+	results.push_back(run_benchmark("planar_average (x, y, z)", grid, 3 * n_elem, 3 * real_size, repeat, [&]() {
+		for (uword direction = 0; direction < 3; ++direction) {
+			average = planar_average(direction, data);
+		}
+	}));
+
+	results.push_back(run_benchmark("gaussian_charges_gen", grid, n_elem, complex_size, repeat, [&]() {
+		model.gaussian_charges_gen();
+	}));
+
+	const double normal_points = grid(model.normal_direction);
+	results.push_back(run_benchmark("dielectric_profiles_gen", grid, normal_points, 3 * sizeof(double) * normal_points, repeat, [&]() {
+		model.dielectric_profiles_gen();
+	}));
+
+	// Uk solves a dense (normal_points x normal_points) system for each k
+	const rowvec K = linspace<rowvec>(0.00001, 10, 100);
+	rowvec Uk;
+	results.push_back(run_benchmark("Uk", grid, K.n_elem * normal_points, K.n_elem * sizeof(cx_double) * normal_points * normal_points, repeat, [&]() {
+		Uk = model.Uk(K);
+	}));
+
+	const string CHGCAR_file = "slabcc_bench.CHGCAR";
+	supercell cell(model.cell_vectors / ang_to_bohr, grid);
+	cell.charge = data;
+	cell.write_CHGCAR(CHGCAR_file);
+	ifstream written_file(CHGCAR_file, ifstream::ate | ifstream::binary);
+	const double file_size = written_file.tellg();
+	written_file.close();
+
+	results.push_back(run_benchmark("CHGCAR write", grid, n_elem, file_size, repeat, [&]() {
+		cell.write_CHGCAR(CHGCAR_file);
+	}));
+
+	cube parsed;
+	results.push_back(run_benchmark("CHGCAR parse", grid, n_elem, file_size, repeat, [&]() {
+		parsed = read_VASP_grid_data(CHGCAR_file);
+	}));
+	remove(CHGCAR_file.c_str());
+
+	return results;
+}
+
+void write_benchmark_json(const vector<benchmark_result>& results, const int& repeat, const string& output_file) {
+	ofstream out_file(output_file);
+	out_file << setprecision(9);
+	out_file << "{\n";
+	out_file << "  \"slabcc_version\": \"" << SLABCC_VERSION_MAJOR << "." << SLABCC_VERSION_MINOR << "." << SLABCC_VERSION_PATCH << "\",\n";
+	out_file << "  \"compilation\": \"" << __DATE__ << " " << __TIME__ << "\",\n";
+	out_file << "  \"threads\": " << omp_get_max_threads() << ",\n";
+	out_file << "  \"repetitions\": " << repeat << ",\n";
+	out_file << "  \"results\": [\n";
+	for (size_t i = 0; i < results.size(); ++i) {
+		const auto& result = results.at(i);
+		const double best_time = min(result.times);
+		out_file << "    {\"kernel\": \"" << result.kernel << "\", "
+			<< "\"grid\": [" << result.grid(0) << ", " << result.grid(1) << ", " << result.grid(2) << "], "
+			<< "\"time_min\": " << best_time << ", "
+			<< "\"time_mean\": " << mean(result.times) << ", "
+			<< "\"elements_per_second\": " << result.elements / best_time << ", "
+			<< "\"GB_per_second\": " << result.bytes / best_time / 1e9 << "}";
+		out_file << (i + 1 < results.size() ? ",\n" : "\n");
+	}
+	out_file << "  ]\n}\n";
+}
+
+int main(int argc, char *argv[]) {
+	string grids_list = "32 32 64; 48 48 96; 64 64 128";
+	string output_file = "slabcc_bench.json";
+	int repeat = 3;
+	bool showHelp = false;
+
+	auto cli = clara::Help(showHelp) |
+		clara::Opt(grids_list, "grid_sizes")
+		["-g"]["--grids"]
+		("grid sizes of the benchmarks: \"nx ny nz; nx ny nz; ...\"") |
+		clara::Opt(repeat, "repetitions")
+		["-r"]["--repeat"]
+		("number of the timed repetitions of each kernel") |
+		clara::Opt(output_file, "output_file")
+		["-o"]["--output"]
+		("JSON output file name");
+
+	const auto cli_result = cli.parse(clara::Args(argc, argv));
+	if (!cli_result) {
+		cerr << "Error in command line: " << cli_result.errorMessage() << '\n';
+		return 1;
+	}
+	if (showHelp) {
+		cout << (clara::Parser() | cli);
+		return 0;
+	}
+
+	auto log = spdlog::stdout_color_mt("loggers");
+	log->set_pattern("%v");
+	log->set_level(spdlog::level::info);
+
+	umat grids;
+	try {
+		grids = umat(grids_list);
+	}
+	catch (const exception&) {
+		grids.reset();
+	}
+	if (grids.n_cols != 3 || repeat < 1) {
+		log->critical("Invalid benchmark grid sizes or repetitions!");
+		return 1;
+	}
+
+	log->info("slabcc benchmarks: {} threads, {} repetitions", omp_get_max_threads(), repeat);
+	vector<benchmark_result> results;
+	for (uword i = 0; i < grids.n_rows; ++i) {
+		const urowvec3 grid = grids.row(i);
+		const auto grid_results = benchmark_grid(grid, repeat);
+		results.insert(results.end(), grid_results.begin(), grid_results.end());
+	}
+
+	write_benchmark_json(results, repeat, output_file);
+	log->info("Benchmark results are written to {}", output_file);
+	return 0;
+}
@@ -0,0 +1,172 @@
+// Copyright (c) 2018-2019, University of Bremen, M. Farzalipour Tabriz
+// Copyrights licensed under the 2-Clause BSD License.
+// See the accompanying LICENSE.txt file for terms.
+
+// Synthetic workload generator for the slabcc:
+// writes the CHGCAR/LOCPOT files of a neutral and a charged system for a slab, bulk, or 2D model
+// The extra charge is described by the Gaussian model charges and its potential is calculated by the same
+// Poisson solver and the dielectric profile as in the slabcc. The neutral system has a uniform electron
+// density inside the slab (or the whole cell for the bulk models) and a zero potential.
+
+#include "stdafx.h"
+#include "slabcc_model.hpp"
+
+using namespace std;
+
+int main(int argc, char *argv[]) {
+	string input_file = "slabcc_gen.in";
+	string output_file = "slabcc_gen.out";
+	string log_file = "slabcc_gen.log";
+	bool showHelp = false;
+
+	auto cli = clara::Help(showHelp) |
+		clara::Opt(input_file, "input_file")
+		["-i"]["--input"]
+		("generator input file name") |
+		clara::Opt(output_file, "output_file")
+		["-o"]["--output"]
+		("generator output file name") |
+		clara::Opt(log_file, "log_file")
+		["-l"]["--log"]
+		("generator log file name");
+
+	const auto cli_result = cli.parse(clara::Args(argc, argv));
+	if (!cli_result) {
+		cerr << "Error in command line: " << cli_result.errorMessage() << '\n';
+		return 1;
+	}
+	if (showHelp) {
+		cout << (clara::Parser() | cli);
+		return 0;
+	}
+
+	prepare_output_file(output_file);
+	initialize_loggers(log_file, output_file);
+	auto log = spdlog::get("loggers");
+	auto output_log = spdlog::get("output");
+
+	INIReader reader(input_file);
+	if (reader.ParseError() < 0) {
+		log->critical("Cannot load the input file: {}", input_file);
+		finalize_loggers();
+		exit(1);
+	}
+
+	verbosity_level = reader.GetInteger("verbosity", 1);
+	const string CHGCAR_neutral = reader.GetStr("CHGCAR_neutral", "CHGCAR.N");
+	const string LOCPOT_neutral = reader.GetStr("LOCPOT_neutral", "LOCPOT.N");
+	const string CHGCAR_charged = reader.GetStr("CHGCAR_charged", "CHGCAR.C");
+	const string LOCPOT_charged = reader.GetStr("LOCPOT_charged", "LOCPOT.C");
+	const rowvec cell_size = reader.GetVec("cell_size", { 10, 10, 20 });	// (Ang)
+	const rowvec grid_size = reader.GetVec("grid_size", { 64, 64, 128 });
+	const string model_name = tolower(reader.GetStr("model", "slab"));	// slab, bulk, 2d
+	const uword normal_direction = xyz2int(reader.GetStr("normal_direction", "z"));
+	const rowvec interfaces = reader.GetVec("interfaces", { 0.25, 0.75 });
+	rowvec diel_in = reader.GetVec("diel_in", { 4, 4, 4 });
+	rowvec diel_out = reader.GetVec("diel_out", { 1, 1, 1 });
+	const double diel_erf_beta = reader.GetReal("diel_taper", 1);
+	const mat charge_position = reader.GetMat("charge_position", { 0.5, 0.5, 0.5 });
+	const rowvec charge_fraction = reader.GetVec("charge_fraction", rowvec(charge_position.n_rows, fill::ones) / charge_position.n_rows);
+	const bool trivariate = reader.GetBoolean("charge_trivariate", false);
+	mat charge_sigma = reader.GetMat("charge_sigma", ones<mat>(charge_position.n_rows, 1));
+	const mat charge_rotations = reader.GetMat("charge_rotation", zeros<mat>(charge_position.n_rows, 3)) * PI / 180.0;
+	const double charge = reader.GetReal("charge", -1);						// total charge of the charged system (e)
+	const double neutral_electrons = reader.GetReal("neutral_electrons", 100);	// number of electrons in the neutral system
+	reader.dump_parsed();
+
+	if (diel_in.n_elem == 1) {
+		diel_in = repelem(diel_in, 1, 3);
+	}
+	if (diel_out.n_elem == 1) {
+		diel_out = repelem(diel_out, 1, 3);
+	}
+	if (charge_sigma.n_cols == 1) {
+		charge_sigma = repmat(charge_sigma, 1, 3);
+	}
+
+	if ((cell_size.n_elem != 3) || (grid_size.n_elem != 3) || (min(grid_size) < 2) ||
+		(diel_in.n_elem != 3) || (diel_out.n_elem != 3) || (interfaces.n_elem != 2) || (charge_position.n_cols != 3) ||
+		(arma::size(charge_sigma) != arma::size(charge_position)) || (arma::size(charge_rotations) != arma::size(charge_position)) ||
+		(charge_fraction.n_elem != charge_position.n_rows)) {
+		log->critical("The generator input parameters are not defined properly!");
+		finalize_loggers();
+		exit(1);
+	}
+
+	const urowvec3 grid = conv_to<urowvec>::from(grid_size);
+	const mat33 cell_vectors = diagmat(cell_size);
+
+	slabcc_model model;
+	model.init_supercell(cell_vectors * ang_to_bohr, grid);
+	model.normal_direction = normal_direction;
+	model.interfaces = interfaces;
+	model.diel_in = diel_in;
+	model.diel_out = diel_out;
+	model.diel_erf_beta = diel_erf_beta;
+	model.charge_position = charge_position;
+	model.charge_sigma = charge_sigma;
+	model.charge_rotations = charge_rotations;
+	model.charge_fraction = charge_fraction;
+	model.trivariate_charge = trivariate;
+	model.defect_charge = charge;
+	if (model_name == "bulk") {
+		model.type = model_type::bulk;
+		model.diel_out = model.diel_in;
+	}
+	else if (model_name == "2d") {
+		model.type = model_type::monolayer;
+	}
+	else {
+		model.type = model_type::slab;
+	}
+
+	// the generated charge is not compared to any target
+	model.in_optimization = true;
+	model.POT_target = zeros(as_size(grid));
+
+	log->info("Generating the extra charge on a {} grid", to_string(grid));
+	model.gaussian_charges_gen();
+	model.dielectric_profiles_gen();
+	model.POT = poisson_solver_3D(model.CHG, model.dielectric_profiles, model.cell_vectors_lengths, model.normal_direction);
+
+	supercell Neutral_supercell(cell_vectors, grid);
+	Neutral_supercell.label = "slabcc_gen neutral " + model_name + " model";
+
+	// electron density of the neutral system: uniform inside the slab (weighted by the dielectric profile)
+	vec diel_weight(grid(normal_direction), fill::ones);
+	const double diel_contrast = model.diel_in(normal_direction) - model.diel_out(normal_direction);
+	if ((model.type != model_type::bulk) && (abs(diel_contrast) > 0.02)) {
+		diel_weight = (model.dielectric_profiles.col(normal_direction) - model.diel_out(normal_direction)) / diel_contrast;
+	}
+	cube density(as_size(grid));
+	for (uword i = 0; i < grid(normal_direction); ++i) {
+		vector<span> spans = { span(), span(), span(i) };
+		swap(spans[normal_direction], spans[2]);
+		density(spans[0], spans[1], spans[2]).fill(diel_weight(i));
+	}
+	// VASP CHGCAR convention: rho * cell volume
+	Neutral_supercell.charge = density * neutral_electrons * density.n_elem / accu(density);
+
+	supercell Charged_supercell = Neutral_supercell;
+	Charged_supercell.label = "slabcc_gen charged " + model_name + " model";
+	Charged_supercell.charge -= real(model.CHG) * model.voxel_vol * model.CHG.n_elem;
+	Charged_supercell.potential -= real(model.POT) * Hartree_to_eV;
+
+	vector<future<void>> future_files;
+	future_files.push_back(async(launch::async, &supercell::write_CHGCAR, Neutral_supercell, CHGCAR_neutral));
+	future_files.push_back(async(launch::async, &supercell::write_LOCPOT, Neutral_supercell, LOCPOT_neutral));
+	future_files.push_back(async(launch::async, &supercell::write_CHGCAR, Charged_supercell, CHGCAR_charged));
+	future_files.push_back(async(launch::async, &supercell::write_LOCPOT, Charged_supercell, LOCPOT_charged));
+	for (auto& promise : future_files) { promise.get(); }
+
+	log->info("Total charge of the model: {}", ::to_string(model.total_charge));
+	log->info("Generated files: {}, {}, {}, {}", CHGCAR_neutral, LOCPOT_neutral, CHGCAR_charged, LOCPOT_charged);
+	finalize_loggers();
+	output_log->info("\n[Results]");
+	output_log->info("total charge of the model = {}", ::to_string(model.total_charge));
+	output_log->info("generated files = {} {} {} {}", CHGCAR_neutral, LOCPOT_neutral, CHGCAR_charged, LOCPOT_charged);
+	if (is_active(verbosity::write_timing_report)) {
+		write_timing_report("slabcc_gen_timing.json");
+	}
+	return 0;
+}
@@ -16,6 +16,40 @@ void input_data::verify() const {
 	charge_rotations = fmod_p(charge_rotations + 90, 180) - 90;
 	charge_rotations *= PI / 180.0;
 
+	if ((potential_resampling != "spline") && (potential_resampling != "fourier")) {
+		log->debug("Potential resampling method: {}", potential_resampling);
+		log->warn("Unsupported potential resampling method has been selected!");
+		potential_resampling = "spline";
+		log->warn("{} will be used instead!", potential_resampling);
+	}
+
+	if ((poisson_solver != "dense") && (poisson_solver != "banded") && (poisson_solver != "pcg") && (poisson_solver != "mixed") && (poisson_solver != "multigrid")) {
+		log->debug("Poisson solver: {}", poisson_solver);
+		log->warn("Unsupported Poisson solver has been selected!");
+		poisson_solver = "dense";
+		log->warn("{} will be used instead!", poisson_solver);
+	}
+
+	poisson_tol = abs(poisson_tol);
+	if (poisson_tol >= 1) {
+		log->debug("Requested Poisson solver tolerance: {}", poisson_tol);
+		log->warn("The relative tolerance of the Poisson solver is unacceptable! It must be in choosen in (0-1) range.");
+		poisson_tol = 1e-6;
+		log->warn("poisson_tolerance = {} will be used!", poisson_tol);
+	}
+
+	if (batch_memory <= 0) {
+		log->debug("Requested memory for the batch jobs: {} GB", batch_memory);
+		batch_memory = 4;
+		log->warn("batch_memory = {} GB will be used!", batch_memory);
+	}
+
+	if (cache_memory < 0) {
+		log->debug("Requested memory for the serve mode cache: {} GB", cache_memory);
+		cache_memory = 4;
+		log->warn("cache_memory = {} GB will be used!", cache_memory);
+	}
+
 	if (!optimize) {
 		log->debug("Optimizer has been deactivated. Model charge parameters will not be optimized!");
 		optimize_charge_fraction = false;
@@ -43,7 +77,7 @@ void input_data::verify() const {
 		log->debug("Minimum of the dielectric tensor inside the slab: {}", min(diel_in));
 		log->debug("Minimum of the dielectric tensor outside the slab: {}", min(diel_out));
 		log->critical("The dielectric tensor has not been defined properly! None of the tensor elements should be negative!");
-		exit(1);
+		throw slabcc_error("The dielectric tensor has not been defined properly!");
 	}
 	if (approx_equal(diel_in, diel_out, "absdiff", 0.02)) { //bulk
 		if (optimize_interface) {
@@ -79,8 +113,7 @@ void input_data::verify() const {
 		log->debug("Number of the parameters defined for the position of a charge: {}", charge_position.n_cols);
 		log->critical("Incorrect definition of charge positions!");
 		log->critical("Positions should be defined as: charge_position = 0.1 0.2 0.3; 0.1 0.2 0.4;");
-		finalize_loggers();
-		exit(1);
+		throw slabcc_error("Incorrect definition of charge positions!");
 	}
 
 	const uword charge_number = charge_position.n_rows;
@@ -185,17 +218,6 @@ void input_data::verify() const {
 	}
 
 
-	if (!file_exists(CHGCAR_neutral) || !file_exists(CHGCAR_charged)
-		|| !file_exists(LOCPOT_neutral) || !file_exists(LOCPOT_charged)) {
-		log->debug("CHGCAR_neutral: '{}' found: {}", CHGCAR_neutral, to_string(file_exists(CHGCAR_neutral)));
-		log->debug("CHGCAR_charged: '{}' found: {}", CHGCAR_charged, to_string(file_exists(CHGCAR_charged)));
-		log->debug("LOCPOT_neutral: '{}' found: {}", LOCPOT_neutral, to_string(file_exists(LOCPOT_neutral)));
-		log->debug("LOCPOT_charged: '{}' found: {}", LOCPOT_charged, to_string(file_exists(LOCPOT_charged)));
-		log->critical("One or more of the input files could not be found!");
-		finalize_loggers();
-		exit(1);
-	}
-
 	if (extrapolate) {
 		if (extrapol_steps_num < 3) {
 			log->debug("Requested extrapolation steps: {}", extrapol_steps_num);
@@ -242,16 +264,26 @@ void input_data::verify() const {
 
 }
 
-void input_data::parse(const string& input_file) const {
+void input_data::parse(const string& input_file, const string& section) const {
 	auto log = spdlog::get("loggers");
-	INIReader reader(input_file);
+	const INIReader reader(input_file, section);
 	if (reader.ParseError() < 0) {
 		log->critical("Cannot load the input file: {}", input_file);
-		finalize_loggers();
-		exit(1);
+		throw slabcc_error("Cannot load the input file: " + input_file);
 	}
+	read(reader, section);
+}
 
-	verbosity_level = reader.GetInteger("verbosity", 1);
+void input_data::parse_string(const string& contents, const string& section) const {
+	read(INIReader::from_string(contents, section), section);
+}
+
+void input_data::read(const INIReader& reader, const string& section) const {
+	// the verbosity is shared by all the batch jobs
+	const int verbosity = reader.GetInteger("verbosity", 1);
+	if (section.empty()) {
+		verbosity_level = verbosity;
+	}
 
 	CHGCAR_neutral = reader.GetStr("CHGCAR_neutral", "CHGCAR.N");
 	LOCPOT_neutral = reader.GetStr("LOCPOT_neutral", "LOCPOT.N");
@@ -280,11 +312,26 @@ void input_data::parse(const string& input_file) const {
 	max_eval = reader.GetInteger("optimize_maxsteps", 0);
 	max_time = reader.GetInteger("optimize_maxtime", 0);
 	opt_grid_x = reader.GetReal("optimize_grid_x", 0.8);
+	potential_resampling = tolower(reader.GetStr("potential_resampling", "spline"));
+	poisson_solver = tolower(reader.GetStr("poisson_solver", "dense"));
+	poisson_tol = reader.GetReal("poisson_tolerance", 1e-6);
 	extrapolate = reader.GetBoolean("extrapolate", model_2D ? false : true);
 	extrapol_grid_x = reader.GetReal("extrapolate_grid_x", 1);
 	extrapol_steps_num = reader.GetInteger("extrapolate_steps_number", model_2D ? 10 : 4);
 	extrapol_steps_size = reader.GetReal("extrapolate_steps_size", model_2D ? 1 : 0.5);
+	batch_memory = reader.GetReal("batch_memory", 4);
+	cache_memory = reader.GetReal("cache_memory", 4);
 
-	reader.dump_parsed();
+	if (section.empty()) {
+		reader.dump_parsed();
+	}
+	else {
+		reader.check_parsed();
+	}
+
+}
 
+vector<string> input_sections(const string& input_file) {
+	const INIReader reader(input_file);
+	return reader.Sections();
 }
\ No newline at end of file
@@ -4,7 +4,7 @@
 
 //references to the input data variables
 struct input_data {
-	string &CHGCAR_neutral, &LOCPOT_charged, &LOCPOT_neutral, &CHGCAR_charged, &opt_algo;
+	string &CHGCAR_neutral, &LOCPOT_charged, &LOCPOT_neutral, &CHGCAR_charged, &opt_algo, &potential_resampling, &poisson_solver;
 	mat &charge_position;
 	rowvec &charge_fraction;
 	mat &charge_sigma, &charge_rotations;
@@ -12,15 +12,27 @@ struct input_data {
 	rowvec &diel_in, &diel_out;
 	uword &normal_direction;
 	rowvec2 &interfaces;
-	double &diel_erf_beta, &opt_tol;
+	double &diel_erf_beta, &opt_tol, &poisson_tol;
 	bool &optimize, &optimize_charge_position, &optimize_charge_sigma, &optimize_charge_rotation, &optimize_charge_fraction, &optimize_interface, &extrapolate, &model_2D, &trivariate;
 	double &opt_grid_x, &extrapol_grid_x;
 	int &max_eval, &max_time, &extrapol_steps_num;
 	double &extrapol_steps_size;
+	double &batch_memory, &cache_memory;
 
 	//read the input variables from the input_file
-	void parse(const string& input_file) const;
+	//the parameters in the [section] of the input_file (batch job) override the parameters before the first section
+	//only the parameters before the first section are written to the output and the log files
+	void parse(const string& input_file, const string& section = "") const;
+
+	//read the input variables from the contents of an input file (e.g. a job of the serve mode)
+	void parse_string(const string& contents, const string& section = "") const;
+
+	//read the input variables from the parsed input file
+	void read(const INIReader& reader, const string& section) const;
 
 	//sanity checks on the input parameters
 	void verify() const;
-};
\ No newline at end of file
+};
+
+//names of the sections (batch jobs) in the input_file
+vector<string> input_sections(const string& input_file);
\ No newline at end of file
@@ -3,39 +3,61 @@
 // See the accompanying LICENSE.txt file for terms.
 
 #include "slabcc_math.hpp"
+#include "slabcc_mpi.hpp"
+#include <list>
 
 cube interp3(const rowvec& x, const rowvec& y, const rowvec& z, const cube& v, const rowvec& xi, const rowvec& yi, const rowvec& zi) {
-	cube v_x = zeros(xi.n_elem, y.n_elem, z.n_elem);
-	cube v_xy = zeros(xi.n_elem, yi.n_elem, z.n_elem);
-	cube v_xyz = zeros(xi.n_elem, yi.n_elem, zi.n_elem);
+	const scoped_timer timer("interp3");
+	cube v_x(xi.n_elem, y.n_elem, z.n_elem);
+	cube v_xy(xi.n_elem, yi.n_elem, z.n_elem);
+	cube v_xyz(xi.n_elem, yi.n_elem, zi.n_elem);
 
-	vec vec_i = zeros<vec>(x.n_elem);
+	// each line is copied into a contiguous buffer of the thread before building its spline
+	#pragma omp parallel
+	{
+		const trace_scope trace("interp3 (OpenMP)");
+		vec line_x(x.n_elem), line_y(y.n_elem), line_z(z.n_elem);
 
-	for (uword i = 0; i < y.n_elem; ++i) {
+		#pragma omp for collapse(2)
 		for (uword j = 0; j < z.n_elem; ++j) {
-			vec_i = vectorise(v(span(), span(i), span(j)));
-			Spline<double> sp(x, vec_i);
-			v_x(span(), span(i), span(j)) = sp.interpolate(xi);
+			for (uword i = 0; i < y.n_elem; ++i) {
+				const double* source = v.slice_colptr(j, i);
+				copy(source, source + x.n_elem, line_x.memptr());
+				const Spline<double> sp(x, line_x);
+				double* destination = v_x.slice_colptr(j, i);
+				for (uword k = 0; k < xi.n_elem; ++k) {
+					destination[k] = sp.interpolate(xi(k));
+				}
+			}
 		}
-	}
 
-	vec_i.set_size(y.n_elem);
-	for (uword i = 0; i < xi.n_elem; ++i) {
+		#pragma omp for collapse(2)
 		for (uword j = 0; j < z.n_elem; ++j) {
-			vec_i = vectorise(v_x(span(i), span(), span(j)));
-			Spline<double> sp(y, vec_i);
-			v_xy(span(i), span(), span(j)) = sp.interpolate(yi);
+			for (uword i = 0; i < xi.n_elem; ++i) {
+				for (uword k = 0; k < y.n_elem; ++k) {
+					line_y(k) = v_x.at(i, k, j);
+				}
+				const Spline<double> sp(y, line_y);
+				for (uword k = 0; k < yi.n_elem; ++k) {
+					v_xy.at(i, k, j) = sp.interpolate(yi(k));
+				}
+			}
 		}
-	}
 
-	vec_i.set_size(z.n_elem);
-	for (uword i = 0; i < xi.n_elem; ++i) {
+		#pragma omp for collapse(2)
 		for (uword j = 0; j < yi.n_elem; ++j) {
-			vec_i = vectorise(v_xy(span(i), span(j), span()));
-			Spline<double> sp(z, vec_i);
-			v_xyz(span(i), span(j), span()) = sp.interpolate(zi);
+			for (uword i = 0; i < xi.n_elem; ++i) {
+				for (uword k = 0; k < z.n_elem; ++k) {
+					line_z(k) = v_xy.at(i, j, k);
+				}
+				const Spline<double> sp(z, line_z);
+				for (uword k = 0; k < zi.n_elem; ++k) {
+					v_xyz.at(i, j, k) = sp.interpolate(zi(k));
+				}
+			}
 		}
 	}
+
 	return v_xyz;
 }
 
@@ -44,6 +66,66 @@ cube interp3(const cube& v, const rowvec& xi, const rowvec& yi, const rowvec& zi
 		v, xi, yi, zi);
 }
 
+namespace {
+	struct frequency_map {
+		uword destination, source;
+		double weight;
+	};
+
+	// Fourier components which are kept when a periodic data with n_source points is resampled to n_destination points
+	// the Nyquist component of the even sizes is split (upsampling) or folded (downsampling) to keep the data real
+	vector<frequency_map> frequency_maps(const uword& n_source, const uword& n_destination) {
+		vector<frequency_map> maps;
+		if (n_source == n_destination) {
+			for (uword k = 0; k < n_source; ++k) {
+				maps.push_back({ k, k, 1 });
+			}
+			return maps;
+		}
+
+		const uword n = min(n_source, n_destination);
+		for (uword k = 0; k < (n + 1) / 2; ++k) {
+			maps.push_back({ k, k, 1 });
+		}
+		for (uword k = 1; k < (n + 1) / 2; ++k) {
+			maps.push_back({ n_destination - k, n_source - k, 1 });
+		}
+		if (n % 2 == 0) {
+			const uword nyquist = n / 2;
+			if (n_destination < n_source) {
+				maps.push_back({ nyquist, nyquist, 1 });
+				maps.push_back({ nyquist, n_source - nyquist, 1 });
+			}
+			else {
+				maps.push_back({ nyquist, nyquist, 0.5 });
+				maps.push_back({ n_destination - nyquist, nyquist, 0.5 });
+			}
+		}
+		return maps;
+	}
+}
+
+cube fourier_resample(const cx_cube& data_k, const urowvec3& new_size) {
+	const scoped_timer timer("fourier_resample");
+	const auto maps_x = frequency_maps(data_k.n_rows, new_size(0));
+	const auto maps_y = frequency_maps(data_k.n_cols, new_size(1));
+	const auto maps_z = frequency_maps(data_k.n_slices, new_size(2));
+
+	cx_cube resampled_k(as_size(new_size), fill::zeros);
+	for (const auto& z : maps_z) {
+		for (const auto& y : maps_y) {
+			const double weight_yz = y.weight * z.weight;
+			for (const auto& x : maps_x) {
+				resampled_k(x.destination, y.destination, z.destination) += x.weight * weight_yz * data_k(x.source, y.source, z.source);
+			}
+		}
+	}
+
+	// forward fft is not normalized and the ifft is normalized by the number of the new grid points
+	resampled_k *= static_cast<double>(resampled_k.n_elem) / data_k.n_elem;
+	return real(ifft(resampled_k));
+}
+
 tuple<cube, cube, cube> ndgrid(const rowvec& v1, const rowvec& v2, const rowvec& v3) {
 
 	cube x(v1.n_elem, v2.n_elem, v3.n_elem, fill::ones), y = x, z = x;
@@ -67,20 +149,18 @@ tuple<cube, cube, cube> meshgrid(const rowvec& v1, const rowvec& v2, const rowve
 	return make_tuple(x2, y2, z2);
 }
 
-cube shift(cube cube_in, rowvec3 shifts) {
+cube shift(const cube& cube_in, rowvec3 shifts) {
+	const scoped_timer timer("shift");
 	if (cube_in.is_empty()) {
 		return {};
 	}
 
 	shifts = round(rowvec3(SizeVec(cube_in) % shifts));
-	for (uword i = 0; i < 3; ++i) {
-		cube_in = shift(cube_in, shifts(i), i);
-	}
-
-	return cube_in;
+	return shift(cube_in, conv_to<irowvec>::from(shifts));
 }
 
 vec planar_average(const uword& direction, const cube& cube_in) {
+	const scoped_timer timer("planar_average");
 	const uword dim_size = arma::size(cube_in)(direction);
 	vec average = vec(dim_size);
 	for (uword i = 0; i < dim_size; ++i) {
@@ -99,13 +179,118 @@ vec planar_average(const uword& direction, const cube& cube_in) {
 	return average;
 }
 
+tuple<vec, vec, vec> planar_sums(const cube& cube_in) {
+	const scoped_timer timer("planar_sums");
+	vec sum_x(cube_in.n_rows, fill::zeros), sum_y(cube_in.n_cols, fill::zeros), sum_z(cube_in.n_slices, fill::zeros);
+
+	// each thread accumulates the x and y sums of its own slices
+	#pragma omp parallel
+	{
+		vec local_x(cube_in.n_rows, fill::zeros), local_y(cube_in.n_cols, fill::zeros);
+		double* x_sums = local_x.memptr();
+		double* y_sums = local_y.memptr();
+
+		#pragma omp for
+		for (uword k = 0; k < cube_in.n_slices; ++k) {
+			double slice_sum = 0;
+			for (uword j = 0; j < cube_in.n_cols; ++j) {
+				const double* column = cube_in.slice_colptr(k, j);
+				double column_sum = 0;
+				for (uword i = 0; i < cube_in.n_rows; ++i) {
+					x_sums[i] += column[i];
+					column_sum += column[i];
+				}
+				y_sums[j] += column_sum;
+				slice_sum += column_sum;
+			}
+			sum_z(k) = slice_sum;
+		}
+
+		#pragma omp critical
+		{
+			sum_x += local_x;
+			sum_y += local_y;
+		}
+	}
+
+	return make_tuple(sum_x, sum_y, sum_z);
+}
+
+double rms_difference(const cx_cube& data, const double& scale, const cube& reference) {
+	const cx_double* data_ptr = data.memptr();
+	const double* reference_ptr = reference.memptr();
+	const uword n_elem = reference.n_elem;
+	double squares_sum = 0;
+
+	#pragma omp parallel for simd reduction(+:squares_sum)
+	for (uword i = 0; i < n_elem; ++i) {
+		const double difference = data_ptr[i].real() * scale - reference_ptr[i];
+		squares_sum += difference * difference;
+	}
+
+	return sqrt(squares_sum / n_elem);
+}
+
+namespace {
+	// the FFTW planner is not thread-safe (concurrent batch jobs): only the fftw_execute may run concurrently
+	mutex fftw_planner_mutex;
+
+	enum class fft_kind :int {
+		r2c_1d, forward_1d, backward_1d, r2c_3d, forward_3d, backward_3d
+	};
+
+	// kind, size (x, y, z), and the alignment of the input and the output arrays of a plan
+	using plan_key = tuple<fft_kind, uword, uword, uword, int, int>;
+	using shared_plan = shared_ptr<remove_pointer<fftw_plan>::type>;
+
+	// number of the plans which are kept for reuse
+	const size_t max_cached_plans = 64;
+
+	// the plans are reused for the arrays with the same size and alignment by the new-array execute functions of the FFTW:
+	// the repeated transforms of the same grids (optimization steps, extrapolation, serve mode jobs) skip the planning.
+	// Plans are kept in the order of their last use. The list is never destroyed: the FFTW may already be cleaned up at the exit (MPI build).
+	list<pair<plan_key, shared_plan>>& cached_plans() {
+		static auto plans = new list<pair<plan_key, shared_plan>>();
+		return *plans;
+	}
+
+	template <typename planner>
+	shared_plan cached_plan(const plan_key& key, const planner& create) {
+		// the evicted plan is destroyed after the release of the lock (its deleter locks the planner)
+		shared_plan evicted;
+		const lock_guard<mutex> lock(fftw_planner_mutex);
+		auto& plans = cached_plans();
+		const auto found = find_if(plans.begin(), plans.end(), [&key](const pair<plan_key, shared_plan>& plan) { return plan.first == key; });
+		if (found != plans.end()) {
+			plans.splice(plans.begin(), plans, found);
+			return plans.front().second;
+		}
+
+		const shared_plan plan(create(), [](fftw_plan expired) {
+			const lock_guard<mutex> lock(fftw_planner_mutex);
+			fftw_destroy_plan(expired);
+		});
+		plans.emplace_front(key, plan);
+		if (plans.size() > max_cached_plans) {
+			evicted = move(plans.back().second);
+			plans.pop_back();
+		}
+		return plan;
+	}
+
+	inline int array_alignment(const void* data) noexcept {
+		return fftw_alignment_of(const_cast<double*>(static_cast<const double*>(data)));
+	}
+}
+
 cx_vec fft(vec X)
 {
 	//TODO: should come up with a better solution than reinterpret_cast
 	cx_vec out(X.n_elem);
-	fftw_plan plan = fftw_plan_dft_r2c_1d(X.n_elem, X.memptr(), reinterpret_cast<fftw_complex*>(out.memptr()), FFTW_ESTIMATE);
-	fftw_execute(plan);
-	fftw_destroy_plan(plan);
+	fftw_complex* out_ptr = reinterpret_cast<fftw_complex*>(out.memptr());
+	const auto plan = cached_plan(plan_key(fft_kind::r2c_1d, X.n_elem, 1, 1, array_alignment(X.memptr()), array_alignment(out_ptr)),
+		[&]() { return fftw_plan_dft_r2c_1d(X.n_elem, X.memptr(), out_ptr, FFTW_ESTIMATE); });
+	fftw_execute_dft_r2c(plan.get(), X.memptr(), out_ptr);
 
 	for (uword i = out.n_elem / 2 + 1; i < out.n_elem; ++i)
 		out(i) = conj(out(X.n_rows - i));
@@ -116,19 +301,23 @@ cx_vec fft(vec X)
 cx_vec fft(cx_vec X)
 {
 	cx_vec out(X.n_elem);
-	fftw_plan plan = fftw_plan_dft_1d(X.n_elem, reinterpret_cast<fftw_complex*>(X.memptr()), reinterpret_cast<fftw_complex*>(out.memptr()), FFTW_FORWARD, FFTW_ESTIMATE);
-	fftw_execute(plan);
-	fftw_destroy_plan(plan);
+	fftw_complex* in_ptr = reinterpret_cast<fftw_complex*>(X.memptr());
+	fftw_complex* out_ptr = reinterpret_cast<fftw_complex*>(out.memptr());
+	const auto plan = cached_plan(plan_key(fft_kind::forward_1d, X.n_elem, 1, 1, array_alignment(in_ptr), array_alignment(out_ptr)),
+		[&]() { return fftw_plan_dft_1d(X.n_elem, in_ptr, out_ptr, FFTW_FORWARD, FFTW_ESTIMATE); });
+	fftw_execute_dft(plan.get(), in_ptr, out_ptr);
 
 	return out;
 }
 
 cx_cube fft(cube X)
 {
+	const scoped_timer timer("fft");
 	cx_cube out(X.n_rows / 2 + 1, X.n_cols, X.n_slices);
-	fftw_plan plan = fftw_plan_dft_r2c_3d(X.n_slices, X.n_cols, X.n_rows, X.memptr(), reinterpret_cast<fftw_complex*>(out.memptr()), FFTW_ESTIMATE);
-	fftw_execute(plan);
-	fftw_destroy_plan(plan);
+	fftw_complex* out_ptr = reinterpret_cast<fftw_complex*>(out.memptr());
+	const auto plan = cached_plan(plan_key(fft_kind::r2c_3d, X.n_rows, X.n_cols, X.n_slices, array_alignment(X.memptr()), array_alignment(out_ptr)),
+		[&]() { return fftw_plan_dft_r2c_3d(X.n_slices, X.n_cols, X.n_rows, X.memptr(), out_ptr, FFTW_ESTIMATE); });
+	fftw_execute_dft_r2c(plan.get(), X.memptr(), out_ptr);
 	out.resize(X.n_rows, X.n_cols, X.n_slices);
 
 	for (uword i = X.n_rows / 2 + 1; i < X.n_rows; ++i) {
@@ -151,10 +340,13 @@ cx_cube fft(cube X)
 
 cx_cube fft(cx_cube X)
 {
+	const scoped_timer timer("fft");
 	cx_cube fft(X.n_rows, X.n_cols, X.n_slices);
-	fftw_plan plan = fftw_plan_dft_3d(X.n_slices, X.n_cols, X.n_rows, reinterpret_cast<fftw_complex*>(X.memptr()), reinterpret_cast<fftw_complex*>(fft.memptr()), FFTW_FORWARD, FFTW_ESTIMATE);
-	fftw_execute(plan);
-	fftw_destroy_plan(plan);
+	fftw_complex* in_ptr = reinterpret_cast<fftw_complex*>(X.memptr());
+	fftw_complex* out_ptr = reinterpret_cast<fftw_complex*>(fft.memptr());
+	const auto plan = cached_plan(plan_key(fft_kind::forward_3d, X.n_rows, X.n_cols, X.n_slices, array_alignment(in_ptr), array_alignment(out_ptr)),
+		[&]() { return fftw_plan_dft_3d(X.n_slices, X.n_cols, X.n_rows, in_ptr, out_ptr, FFTW_FORWARD, FFTW_ESTIMATE); });
+	fftw_execute_dft(plan.get(), in_ptr, out_ptr);
 
 	return fft;
 }
@@ -162,19 +354,24 @@ cx_cube fft(cx_cube X)
 cx_vec ifft(cx_vec X)
 {
 	cx_vec out(X.n_elem);
-	fftw_plan plan = fftw_plan_dft_1d(X.n_elem, reinterpret_cast<fftw_complex*>(X.memptr()), reinterpret_cast<fftw_complex*>(out.memptr()), FFTW_BACKWARD, FFTW_ESTIMATE);
-	fftw_execute(plan);
-	fftw_destroy_plan(plan);
+	fftw_complex* in_ptr = reinterpret_cast<fftw_complex*>(X.memptr());
+	fftw_complex* out_ptr = reinterpret_cast<fftw_complex*>(out.memptr());
+	const auto plan = cached_plan(plan_key(fft_kind::backward_1d, X.n_elem, 1, 1, array_alignment(in_ptr), array_alignment(out_ptr)),
+		[&]() { return fftw_plan_dft_1d(X.n_elem, in_ptr, out_ptr, FFTW_BACKWARD, FFTW_ESTIMATE); });
+	fftw_execute_dft(plan.get(), in_ptr, out_ptr);
 
 	return out / out.n_elem;
 }
 
 cx_cube ifft(cx_cube X)
 {
+	const scoped_timer timer("ifft");
 	cx_cube ifft(X.n_rows, X.n_cols, X.n_slices);
-	fftw_plan plan = fftw_plan_dft_3d(X.n_slices, X.n_cols, X.n_rows, reinterpret_cast<fftw_complex*>(X.memptr()), reinterpret_cast<fftw_complex*>(ifft.memptr()), FFTW_BACKWARD, FFTW_ESTIMATE);
-	fftw_execute(plan);
-	fftw_destroy_plan(plan);
+	fftw_complex* in_ptr = reinterpret_cast<fftw_complex*>(X.memptr());
+	fftw_complex* out_ptr = reinterpret_cast<fftw_complex*>(ifft.memptr());
+	const auto plan = cached_plan(plan_key(fft_kind::backward_3d, X.n_rows, X.n_cols, X.n_slices, array_alignment(in_ptr), array_alignment(out_ptr)),
+		[&]() { return fftw_plan_dft_3d(X.n_slices, X.n_cols, X.n_rows, in_ptr, out_ptr, FFTW_BACKWARD, FFTW_ESTIMATE); });
+	fftw_execute_dft(plan.get(), in_ptr, out_ptr);
 
 	return ifft / X.n_elem;
 }
@@ -205,10 +402,333 @@ double fmod_p(double num, const double& denom) noexcept {
 	return num;
 }
 
+void solve_hpd(cx_mat& X, const cx_mat& A, const cx_mat& B) {
+	cx_mat R;
+	if (chol(R, A)) {
+		// A = R' * R
+		const cx_mat Rt = R.t();
+		X = solve(trimatu(R), solve(trimatl(Rt), B));
+	}
+	else {
+		X = solve(A, B);
+	}
+}
+
+bool solve_hpd_mixed(cx_mat& X, const cx_mat& A, const cx_mat& B, double& relative_residual) {
+	const uword max_refinement_steps = 4;
+	const double target_residual = 1e-12;
+	const double B_norm = norm(B, "fro");
+	cx_fmat R;
+	if ((B_norm > 0) && chol(R, conv_to<cx_fmat>::from(A))) {
+		// A = R' * R in the single precision
+		const cx_fmat Rt = R.t();
+		const auto solve_single = [&](const cx_mat& rhs) {
+			const cx_fmat rhs_single = conv_to<cx_fmat>::from(rhs);
+			return conv_to<cx_mat>::from(cx_fmat(solve(trimatu(R), solve(trimatl(Rt), rhs_single))));
+		};
+
+		X = solve_single(B);
+		for (uword step = 0; step <= max_refinement_steps; ++step) {
+			const cx_mat residual = B - A * X;
+			relative_residual = norm(residual, "fro") / B_norm;
+			if (relative_residual <= target_residual) {
+				return true;
+			}
+			if (step < max_refinement_steps) {
+				X += solve_single(residual);
+			}
+		}
+	}
+
+	// no convergence: solve in the double precision
+	solve_hpd(X, A, B);
+	relative_residual = (B_norm > 0) ? norm(B - A * X, "fro") / B_norm : 0;
+	return false;
+}
+
+
+namespace {
+	// number of the tubes which are gathered into a panel and solved together in the Poisson solver
+	const uword poisson_panel_width = 16;
+
+	// linear index of the element "l" of the tube (k, m) along the normal direction
+	// k, m: indices in the (swapped) x and y directions of the Poisson solver
+	template <uword normal_direction>
+	inline uword tube_element_index(const uword& n_rows, const uword& n_cols, const uword& k, const uword& m, const uword& l) noexcept {
+		switch (normal_direction) {
+		case 0: return l + m * n_rows + k * n_rows * n_cols;
+		case 1: return k + l * n_rows + m * n_rows * n_cols;
+		default: return k + m * n_rows + l * n_rows * n_cols;
+		}
+	}
+
+	// copies the tubes (k_first ... k_first + panel.n_cols - 1, m) of the cube into the columns of the panel (to_panel = true) or vice versa
+	// the loops follow the contiguous direction of the cube in the memory
+	template <uword normal_direction>
+	void transfer_panel(cx_double* cube_ptr, const uword& n_rows, const uword& n_cols, const uword& k_first, const uword& m, cx_mat& panel, const bool& to_panel) noexcept {
+		const uword width = panel.n_cols;
+		const uword tube_length = panel.n_rows;
+		if (normal_direction == 0) {
+			for (uword i = 0; i < width; ++i) {
+				cx_double* tube = cube_ptr + tube_element_index<0>(n_rows, n_cols, k_first + i, m, 0);
+				cx_double* column = panel.colptr(i);
+				if (to_panel) { std::copy(tube, tube + tube_length, column); }
+				else { std::copy(column, column + tube_length, tube); }
+			}
+		}
+		else {
+			for (uword l = 0; l < tube_length; ++l) {
+				cx_double* row = cube_ptr + tube_element_index<normal_direction>(n_rows, n_cols, k_first, m, l);
+				for (uword i = 0; i < width; ++i) {
+					if (to_panel) { panel(l, i) = row[i]; }
+					else { row[i] = panel(l, i); }
+				}
+			}
+		}
+	}
+
+	// solves the Poisson equation for all the tubes of the rhok cubes along the normal direction and writes the results into the Vk cubes
+	// each thread gathers the tubes with the same Gy into panels, solves them, and scatters the results back
+	// solve_tube(k, m, rhs, solution) solves the system of (Gx(k), Gy(m)) for the tubes of all the rhok cubes (columns of the rhs) together
+	// must be called inside an OpenMP parallel region: the inputs are shared and only the panels and the solver workspace are per-thread
+	template <uword normal_direction, typename F>
+	void poisson_tube_solves_along(const vector<cx_cube>& rhok, const uword& n_Gx, const uword& n_Gy, vector<cx_cube>& Vk, F& solve_tube) {
+		const uword n_rows = rhok.front().n_rows;
+		const uword n_cols = rhok.front().n_cols;
+		const uword tube_length = (normal_direction == 0) ? n_rows : ((normal_direction == 1) ? n_cols : rhok.front().n_slices);
+		const uword n_rhs = rhok.size();
+		vector<cx_mat> panels(n_rhs);
+		cx_mat rhs(tube_length, n_rhs), solution;
+
+		// there may be fewer Gy than the threads: the panels of all the Gy are distributed together
+#pragma omp for collapse(2) schedule(dynamic)
+		for (uword m = 0; m < n_Gy; ++m) {
+			for (uword k_first = 0; k_first < n_Gx; k_first += poisson_panel_width) {
+				const uword width = std::min(poisson_panel_width, n_Gx - k_first);
+				for (uword r = 0; r < n_rhs; ++r) {
+					panels[r].set_size(tube_length, width);
+					transfer_panel<normal_direction>(const_cast<cx_double*>(rhok[r].memptr()), n_rows, n_cols, k_first, m, panels[r], true);
+				}
+				for (uword i = 0; i < width; ++i) {
+					for (uword r = 0; r < n_rhs; ++r) {
+						rhs.col(r) = panels[r].col(i);
+					}
+					solve_tube(k_first + i, m, rhs, solution);
+					for (uword r = 0; r < n_rhs; ++r) {
+						panels[r].col(i) = solution.col(r);
+					}
+				}
+				for (uword r = 0; r < n_rhs; ++r) {
+					transfer_panel<normal_direction>(Vk[r].memptr(), n_rows, n_cols, k_first, m, panels[r], false);
+				}
+			}
+		}
+	}
+
+	template <typename F>
+	void poisson_tube_solves(const uword& normal_direction, const vector<cx_cube>& rhok, const uword& n_Gx, const uword& n_Gy, vector<cx_cube>& Vk, F& solve_tube) {
+		switch (normal_direction) {
+		case 0: poisson_tube_solves_along<0>(rhok, n_Gx, n_Gy, Vk, solve_tube); break;
+		case 1: poisson_tube_solves_along<1>(rhok, n_Gx, n_Gy, Vk, solve_tube); break;
+		default: poisson_tube_solves_along<2>(rhok, n_Gx, n_Gy, Vk, solve_tube); break;
+		}
+	}
+
+	// bandwidth of the dielectric matrices after truncating the Fourier series of the dielectric profiles (columns of the dielsG)
+	// at the tolerance relative to their average value
+	// returns the bandwidth and the largest relative norm of the dropped Fourier components
+	tuple<uword, double> dielectric_bandwidth(const cx_mat& dielsG, const double& tolerance) {
+		const uword N = dielsG.n_rows;
+		const mat magnitudes = abs(dielsG);
+		uword bandwidth = 0;
+		for (uword c = 0; c < magnitudes.n_cols; ++c) {
+			const double threshold = tolerance * magnitudes(0, c);
+			for (uword n = 1; n <= N / 2; ++n) {
+				if ((magnitudes(n, c) > threshold) || (magnitudes(N - n, c) > threshold)) {
+					bandwidth = std::max(bandwidth, n);
+				}
+			}
+		}
+
+		double dropped_norm = 0;
+		if (2 * bandwidth + 1 < N) {
+			for (uword c = 0; c < magnitudes.n_cols; ++c) {
+				const double tail = norm(magnitudes(span(bandwidth + 1, N - bandwidth - 1), c));
+				dropped_norm = std::max(dropped_norm, tail / norm(magnitudes.col(c)));
+			}
+		}
+		return make_tuple(bandwidth, dropped_norm);
+	}
+
+	// order of the indices 0, N-1, 1, N-2, 2, ... which turns a circulant band matrix with the bandwidth b into a band matrix
+	// with the bandwidth 2b+1 without dropping its wrap-around elements
+	uvec interleaved_order(const uword& N) {
+		uvec order(N);
+		for (uword n = 0; n < N; ++n) {
+			order(n) = (n % 2 == 0) ? n / 2 : N - 1 - n / 2;
+		}
+		return order;
+	}
+
+	// lower band storage of the matrix A with its rows and columns in the order of the permutation:
+	// band(d, j) = A(order(j + d), order(j)) for d = 0 ... bandwidth
+	cx_mat band_storage(const cx_mat& A, const uvec& order, const uword& bandwidth) {
+		const uword N = A.n_rows;
+		cx_mat band(bandwidth + 1, N, fill::zeros);
+		for (uword j = 0; j < N; ++j) {
+			for (uword d = 0; (d <= bandwidth) && (j + d < N); ++d) {
+				band(d, j) = A(order(j + d), order(j));
+			}
+		}
+		return band;
+	}
+
+	// in-place Cholesky factorization (A = L * L') of a Hermitian positive definite matrix in the lower band storage
+	// returns false if the matrix is not positive definite
+	bool band_cholesky(cx_mat& band) noexcept {
+		const uword bandwidth = band.n_rows - 1;
+		const uword N = band.n_cols;
+		for (uword j = 0; j < N; ++j) {
+			const uword k_first = (j > bandwidth) ? j - bandwidth : 0;
+			double diagonal = band(0, j).real();
+			for (uword k = k_first; k < j; ++k) {
+				diagonal -= std::norm(band(j - k, k));
+			}
+			if (diagonal <= 0) { return false; }
+			const double L_jj = sqrt(diagonal);
+			band(0, j) = L_jj;
+
+			for (uword i = j + 1; i < std::min(N, j + bandwidth + 1); ++i) {
+				cx_double L_ij = band(i - j, j);
+				for (uword k = (i > bandwidth) ? i - bandwidth : 0; k < j; ++k) {
+					L_ij -= band(i - k, k) * conj(band(j - k, k));
+				}
+				band(i - j, j) = L_ij / L_jj;
+			}
+		}
+		return true;
+	}
+
+	// solves L * L' * X = B with the factorized band matrix. B is overwritten by X
+	void band_cholesky_solve(const cx_mat& band, cx_mat& B) noexcept {
+		const uword bandwidth = band.n_rows - 1;
+		const uword N = band.n_cols;
+		for (uword c = 0; c < B.n_cols; ++c) {
+			cx_double* x = B.colptr(c);
+			for (uword i = 0; i < N; ++i) {
+				cx_double sum = x[i];
+				for (uword k = (i > bandwidth) ? i - bandwidth : 0; k < i; ++k) {
+					sum -= band(i - k, k) * x[k];
+				}
+				x[i] = sum / band(0, i).real();
+			}
+			for (uword i = N; i-- > 0;) {
+				cx_double sum = x[i];
+				for (uword k = i + 1; k < std::min(N, i + bandwidth + 1); ++k) {
+					sum -= conj(band(k - i, i)) * x[k];
+				}
+				x[i] = sum / band(0, i).real();
+			}
+		}
+	}
+
+	// checks if all the dielectric profiles are even about the origin (and the center) of the cell: diel(j) = diel(N - j)
+	bool is_mirror_symmetric(const mat& diel) {
+		const uword N = diel.n_rows;
+		const double tolerance = 1e-10 * abs(diel).max();
+		for (uword j = 1; j < N; ++j) {
+			if (any(abs(diel.row(j) - diel.row(N - j)) > tolerance)) { return false; }
+		}
+		return true;
+	}
+
+	// orthogonal transformation of the components of N Gz (in the FFT order) into their even and odd combinations:
+	// G=0, (G_n + G_-n)/sqrt(2) for n = 1 ... (N-1)/2, (G_n - G_-n)/sqrt(2) for n = 1 ... (N-1)/2, and the Nyquist component for the even N
+	mat mirror_basis(const uword& N) {
+		const uword pairs = (N - 1) / 2;
+		mat T(N, N, fill::zeros);
+		T(0, 0) = 1;
+		for (uword n = 1; n <= pairs; ++n) {
+			T(n, n) = 1 / sqrt(2.0);
+			T(n, N - n) = 1 / sqrt(2.0);
+			T(pairs + n, n) = 1 / sqrt(2.0);
+			T(pairs + n, N - n) = -1 / sqrt(2.0);
+		}
+		if (N % 2 == 0) { T(N - 1, N / 2) = 1; }
+		return T;
+	}
+
+	// Poisson solver for the uniform dielectric tensor (bulk models):
+	// the dielectric matrices are diagonal in the k-space and V(G) = 4PI * rho(G) / (eps_xx * Gx^2 + eps_yy * Gy^2 + eps_zz * Gz^2)
+	vector<cx_cube> poisson_solver_uniform(const vector<cx_cube>& rho, const rowvec3& diel, const rowvec3& lengths) {
+		const scoped_timer timer("uniform dielectric solve");
+		const auto n_points = SizeVec(rho.front());
+		const rowvec Gs = 2.0 * PI / lengths;
+		vector<rowvec> epsG2(3);
+		for (uword i = 0; i < 3; ++i) {
+			const rowvec G0 = ifftshift(rowvec(ceil(regspace<rowvec>(-0.5 * n_points(i), 0.5 * n_points(i) - 1)) * Gs(i)));
+			epsG2[i] = diel(i) * square(G0);
+		}
+
+		vector<cx_cube> V(rho.size());
+		for (uword r = 0; r < rho.size(); ++r) {
+			cx_cube Vk = fft(rho[r]);
+#pragma omp parallel for
+			for (uword l = 1; l < Vk.n_slices; ++l) {
+				for (uword j = 0; j < Vk.n_cols; ++j) {
+					cx_double* column = Vk.slice_colptr(l, j);
+					for (uword i = 0; i < Vk.n_rows; ++i) {
+						column[i] *= 4.0 * PI / (epsG2[0](i) + epsG2[1](j) + epsG2[2](l));
+					}
+				}
+			}
+			for (uword j = 0; j < Vk.n_cols; ++j) {
+				cx_double* column = Vk.slice_colptr(0, j);
+				for (uword i = 0; i < Vk.n_rows; ++i) {
+					column[i] *= 4.0 * PI / (epsG2[0](i) + epsG2[1](j));
+				}
+			}
+			// 0,0,0 in k-space corresponds to a constant in the real space: average potential over the supercell.
+			Vk(0, 0, 0) = 0;
+			V[r] = ifft(Vk);
+		}
+
+		return V;
+	}
+}
+
+cx_cube poisson_solver_3D(const cx_cube& rho, mat diel, rowvec3 lengths, uword normal_direction, const poisson_method& method, const double& tolerance) {
+	return poisson_solver_3D(vector<cx_cube>{ rho }, diel, lengths, normal_direction, method, tolerance).front();
+}
+
+vector<cx_cube> poisson_solver_3D(const vector<cx_cube>& rho, mat diel, rowvec3 lengths, uword normal_direction, const poisson_method& method, const double& tolerance) {
+	const scoped_timer timer("poisson_solver_3D");
+	auto n_points = SizeVec(rho.front());
 
+	// no variations in the dielectric profiles (bulk models): no need for the dense solves
+	if (all(vectorise(max(diel) - min(diel) <= 1e-12 * max(abs(vectorise(diel)))))) {
+		return poisson_solver_uniform(rho, diel.row(0), lengths);
+	}
+
+	if ((method == poisson_method::pcg) || (method == poisson_method::multigrid)) {
+		vector<cx_cube> V;
+		for (const auto& density : rho) {
+			if (method == poisson_method::pcg) {
+				V.push_back(poisson_solver_pcg(density, diel, lengths, normal_direction, tolerance, cx_cube()));
+			}
+			else {
+				V.push_back(poisson_solver_multigrid(density, diel, lengths, normal_direction, tolerance, cx_cube()));
+			}
+		}
+		return V;
+	}
 
-cx_cube poisson_solver_3D(const cx_cube& rho, mat diel, rowvec3 lengths, uword normal_direction) {
-	auto n_points = SizeVec(rho);
+#ifdef SLABCC_MPI
+	// the tubes are distributed over the MPI ranks and solved by the dense solver
+	if (mpi_ranks() > 1) {
+		return poisson_solver_mpi(rho, diel, lengths, normal_direction);
+	}
+#endif
 
 	if (normal_direction != 2) {
 		n_points.swap_cols(normal_direction, 2);
@@ -227,29 +747,544 @@ cx_cube poisson_solver_3D(const cx_cube& rho, mat diel, rowvec3 lengths, uword n
 	Gz0 = ifftshift(Gz0);
 
 	// 4PI is for the atomic units
-	const auto rhok = fft(cx_cube(4.0 * PI * rho));
+	vector<cx_cube> rhok(rho.size()), Vk(rho.size());
+	for (uword r = 0; r < rho.size(); ++r) {
+		rhok[r] = fft(cx_cube(4.0 * PI * rho[r]));
+		Vk[r].set_size(arma::size(rhok[r]));
+	}
 	const cx_mat dielsG = fft(diel);
 	const cx_mat eps11 = circ_toeplitz(dielsG.col(0)) / Gz0.n_elem;
 	const cx_mat eps22 = circ_toeplitz(dielsG.col(1)) / Gz0.n_elem;
 	const cx_mat eps33 = circ_toeplitz(dielsG.col(2)) / Gz0.n_elem;
 	const mat GzGzp = Gz0.t() * Gz0;
 	const cx_mat Az = eps33 % GzGzp;
-	cx_cube Vk(arma::size(rhok));
 
-#pragma omp parallel for firstprivate(Az,eps11,eps22,rhok)
-	for (uword k = 0; k < Gx0.n_elem; ++k) {
-		const cx_mat eps11_Gx0k2 = eps11 * square(Gx0(k));
-		for (uword m = 0; m < Gy0.n_elem; ++m) {
-			vector<span> spans = { span(k), span(m), span() };
-			swap(spans[normal_direction], spans[2]);
-			cx_mat AG = Az + eps11_Gx0k2 + eps22 * square(Gy0(m));
-			if ((k == 0) && (m == 0)) { AG(0, 0) = 1; }
-			Vk(spans[0], spans[1], spans[2]) = solve(AG, vectorise(rhok(spans[0], spans[1], spans[2])));
+	// dielectric profiles which are even about the cell center (symmetric slabs in the middle of the cell)
+	const bool mirror_symmetric = (method == poisson_method::dense) && (Gz0.n_elem > 3) && is_mirror_symmetric(diel);
+
+	// the band storage is only used if it is considerably smaller than the dense matrices
+	uword bandwidth = Gz0.n_elem;
+	if (method == poisson_method::banded) {
+		auto log = spdlog::get("loggers");
+		double dropped_norm = 0;
+		tie(bandwidth, dropped_norm) = dielectric_bandwidth(dielsG, tolerance);
+		bandwidth = std::min(2 * bandwidth + 1, Gz0.n_elem - 1);
+		if (4 * bandwidth < Gz0.n_elem) {
+			log->debug("Banded Poisson solver: bandwidth {} of {}, relative norm of the dropped dielectric Fourier components: {}", bandwidth, Gz0.n_elem, dropped_norm);
+		}
+		else {
+			log->debug("Banded Poisson solver: the dielectric Fourier components do not decay fast enough on this grid (bandwidth {} of {}). The dense solver will be used!", bandwidth, Gz0.n_elem);
 		}
 	}
-	// 0,0,0 in k-space corresponds to a constant in the real space: average potential over the supercell.
-	Vk(0, 0, 0) = 0;
-	const cx_cube V = ifft(Vk);
+
+	if (mirror_symmetric) {
+		const scoped_timer solve_timer("mirror symmetric solves");
+		// the AG matrices of the even profiles are real and symmetric and do not couple the even and odd combinations of the +Gz and -Gz.
+		// The two blocks are factorized separately in the real arithmetic.
+		// The Nyquist component (even number of the Gz) is coupled to both blocks and is eliminated by its Schur complement.
+		const uword N = Gz0.n_elem;
+		const uword n_even = 1 + (N - 1) / 2;
+		const uword n_odd = (N - 1) / 2;
+		const bool nyquist = (N % 2 == 0);
+		const span even(0, n_even - 1), odd(n_even, n_even + n_odd - 1);
+		const mat T = mirror_basis(N);
+		const mat T_z = T * real(Az) * T.t();
+		const mat T_11 = T * real(eps11) * T.t();
+		const mat T_22 = T * real(eps22) * T.t();
+#pragma omp parallel
+		{
+			const trace_scope trace("poisson_solver_3D: mirror symmetric solves (OpenMP)");
+			mat A, B, R_even, R_odd, X(N, 1);
+			cx_mat AG;
+			const auto solve_spd = [](const mat& R, const mat& rhs) {
+				const mat Rt = R.t();
+				return mat(solve(trimatu(R), solve(trimatl(Rt), rhs)));
+			};
+			auto solve_tube = [&](const uword& k, const uword& m, const cx_mat& rhs, cx_mat& solution) {
+				A = T_z + T_11 * square(Gx0(k)) + T_22 * square(Gy0(m));
+				if ((k == 0) && (m == 0)) { A(0, 0) = 1; }
+				if (!chol(R_even, A(even, even)) || !chol(R_odd, A(odd, odd))) {
+					AG = Az + eps11 * square(Gx0(k)) + eps22 * square(Gy0(m));
+					if ((k == 0) && (m == 0)) { AG(0, 0) = 1; }
+					solve_hpd(solution, AG, rhs);
+					return;
+				}
+
+				// real and imaginary parts as the separate right-hand sides (+ the coupling of the Nyquist component)
+				const uword n_rhs = 2 * rhs.n_cols;
+				const cx_mat rhs_T = T * rhs;
+				B = join_rows(real(rhs_T), imag(rhs_T));
+				if (nyquist) { B = join_rows(B, A.col(N - 1)); }
+				X.set_size(N, B.n_cols);
+				X.rows(even) = solve_spd(R_even, B.rows(even));
+				X.rows(odd) = solve_spd(R_odd, B.rows(odd));
+				if (nyquist) {
+					const vec coupling = A.col(N - 1).head(N - 1);
+					const rowvec coupled = coupling.t() * X.rows(0, N - 2);
+					const rowvec nyquist_component = (B.row(N - 1).head(n_rhs) - coupled.head(n_rhs)) / (A(N - 1, N - 1) - coupled(n_rhs));
+					X.submat(0, 0, N - 2, n_rhs - 1) -= X(span(0, N - 2), span(n_rhs)) * nyquist_component;
+					X.row(N - 1).head(n_rhs) = nyquist_component;
+				}
+				solution = T.t() * cx_mat(X.head_cols(n_rhs / 2), X.cols(n_rhs / 2, n_rhs - 1));
+			};
+			poisson_tube_solves(normal_direction, rhok, Gx0.n_elem, Gy0.n_elem, Vk, solve_tube);
+		}
+	}
+	else if (4 * bandwidth < Gz0.n_elem) {
+		const scoped_timer solve_timer("banded solves");
+		// the AG matrices are circulant band matrices (apart from the diagonal Gz scaling) in the FFT order of the Gz
+		// G=0 is the first element of the interleaved order
+		const uvec order = interleaved_order(Gz0.n_elem);
+		const uword G0_index = 0;
+		const cx_mat band_11 = band_storage(eps11, order, bandwidth);
+		const cx_mat band_22 = band_storage(eps22, order, bandwidth);
+		const cx_mat band_z = band_storage(Az, order, bandwidth);
+#pragma omp parallel
+		{
+			const trace_scope trace("poisson_solver_3D: banded solves (OpenMP)");
+			cx_mat band, AG;
+			auto solve_tube = [&](const uword& k, const uword& m, const cx_mat& rhs, cx_mat& solution) {
+				band = band_z + band_11 * square(Gx0(k)) + band_22 * square(Gy0(m));
+				if ((k == 0) && (m == 0)) { band(0, G0_index) = 1; }
+				if (band_cholesky(band)) {
+					cx_mat sorted_rhs = rhs.rows(order);
+					band_cholesky_solve(band, sorted_rhs);
+					solution.set_size(arma::size(rhs));
+					solution.rows(order) = sorted_rhs;
+				}
+				else {
+					// the truncated matrix is not positive definite
+					AG = Az + eps11 * square(Gx0(k)) + eps22 * square(Gy0(m));
+					if ((k == 0) && (m == 0)) { AG(0, 0) = 1; }
+					solve_hpd(solution, AG, rhs);
+				}
+			};
+			poisson_tube_solves(normal_direction, rhok, Gx0.n_elem, Gy0.n_elem, Vk, solve_tube);
+		}
+	}
+	else {
+		const bool mixed_precision = (method == poisson_method::mixed);
+		const scoped_timer solve_timer(mixed_precision ? "mixed precision solves" : "dense solves");
+		double max_residual = 0;
+		uword double_precision_solves = 0;
+#pragma omp parallel
+		{
+			const trace_scope trace("poisson_solver_3D: dense solves (OpenMP)");
+			cx_mat AG;
+			double thread_max_residual = 0;
+			uword thread_double_precision_solves = 0;
+			auto solve_tube = [&](const uword& k, const uword& m, const cx_mat& rhs, cx_mat& solution) {
+				AG = Az + eps11 * square(Gx0(k)) + eps22 * square(Gy0(m));
+				// AG is Hermitian positive definite (the G=0 row and column are decoupled by the AG(0, 0) = 1)
+				if ((k == 0) && (m == 0)) { AG(0, 0) = 1; }
+				if (mixed_precision) {
+					double residual = 0;
+					if (!solve_hpd_mixed(solution, AG, rhs, residual)) {
+						++thread_double_precision_solves;
+					}
+					thread_max_residual = std::max(thread_max_residual, residual);
+				}
+				else {
+					solve_hpd(solution, AG, rhs);
+				}
+			};
+			poisson_tube_solves(normal_direction, rhok, Gx0.n_elem, Gy0.n_elem, Vk, solve_tube);
+#pragma omp critical
+			{
+				max_residual = std::max(max_residual, thread_max_residual);
+				double_precision_solves += thread_double_precision_solves;
+			}
+		}
+		if (mixed_precision) {
+			auto log = spdlog::get("loggers");
+			log->debug("Mixed precision Poisson solver: largest relative residual {}, systems solved in double precision: {} of {}", max_residual, double_precision_solves, Gx0.n_elem * Gy0.n_elem);
+		}
+	}
+	vector<cx_cube> V(rho.size());
+	for (uword r = 0; r < rho.size(); ++r) {
+		// 0,0,0 in k-space corresponds to a constant in the real space: average potential over the supercell.
+		Vk[r](0, 0, 0) = 0;
+		V[r] = ifft(Vk[r]);
+	}
 
 	return V;
 }
+
+namespace {
+	// real part of the inner product of two complex cubes: real(sum(conj(A) % B))
+	double real_inner_product(const cx_cube& A, const cx_cube& B) {
+		const cx_double* A_ptr = A.memptr();
+		const cx_double* B_ptr = B.memptr();
+		const uword n_elem = A.n_elem;
+		double sum = 0;
+#pragma omp parallel for reduction(+:sum)
+		for (uword i = 0; i < n_elem; ++i) {
+			sum += A_ptr[i].real() * B_ptr[i].real() + A_ptr[i].imag() * B_ptr[i].imag();
+		}
+		return sum;
+	}
+
+	// multiplies the cube elements by the values of the vector along the rows (dim = 0), columns (dim = 1), or slices (dim = 2)
+	template <typename T>
+	void multiply_along(cx_cube& A, const Col<T>& values, const uword& dim) {
+#pragma omp parallel for
+		for (uword l = 0; l < A.n_slices; ++l) {
+			for (uword j = 0; j < A.n_cols; ++j) {
+				cx_double* column = A.slice_colptr(l, j);
+				for (uword i = 0; i < A.n_rows; ++i) {
+					column[i] *= values((dim == 0) ? i : ((dim == 1) ? j : l));
+				}
+			}
+		}
+	}
+}
+
+cx_cube poisson_solver_pcg(const cx_cube& rho, const mat& diel, const rowvec3& lengths, const uword& normal_direction, const double& tolerance, const cx_cube& V_initial) {
+	const scoped_timer timer("poisson_solver_pcg");
+	auto log = spdlog::get("loggers");
+	const uword max_iterations = 1000;
+	const auto n_points = SizeVec(rho);
+	const rowvec Gs = 2.0 * PI / lengths;
+	vector<vec> G(3);
+	for (uword d = 0; d < 3; ++d) {
+		const rowvec G0 = ceil(regspace<rowvec>(-0.5 * n_points(d), 0.5 * n_points(d) - 1)) * Gs(d);
+		G[d] = ifftshift(G0).t();
+	}
+
+	// -div(eps grad(V)) in the k-space: sum_d G_d * FFT(eps_dd(normal) * IFFT(G_d * V))
+	const auto apply_operator = [&](const cx_cube& Vk) {
+		cx_cube AV(arma::size(Vk), fill::zeros);
+		for (uword d = 0; d < 3; ++d) {
+			cx_cube gradient = Vk;
+			multiply_along(gradient, G[d], d);
+			gradient = ifft(gradient);
+			multiply_along(gradient, vec(diel.col(d)), normal_direction);
+			gradient = fft(gradient);
+			multiply_along(gradient, G[d], d);
+			AV += gradient;
+		}
+		return AV;
+	};
+
+	// preconditioner: inverse of the operator for the average dielectric tensor (diagonal in the k-space)
+	const rowvec diel_average = mean(diel);
+	cube preconditioner(n_points(0), n_points(1), n_points(2));
+	for (uword l = 0; l < preconditioner.n_slices; ++l) {
+		for (uword j = 0; j < preconditioner.n_cols; ++j) {
+			for (uword i = 0; i < preconditioner.n_rows; ++i) {
+				preconditioner(i, j, l) = 1.0 / (diel_average(0) * square(G[0](i)) + diel_average(1) * square(G[1](j)) + diel_average(2) * square(G[2](l)));
+			}
+		}
+	}
+	// 0,0,0 in k-space corresponds to a constant in the real space: average potential over the supercell.
+	preconditioner(0, 0, 0) = 0;
+
+	// 4PI is for the atomic units
+	cx_cube rhok = fft(cx_cube(4.0 * PI * rho));
+	rhok(0, 0, 0) = 0;
+	const double rhok_norm = sqrt(real_inner_product(rhok, rhok));
+	if (rhok_norm == 0) {
+		return cx_cube(arma::size(rho), fill::zeros);
+	}
+
+	// warm start from the previous potential
+	cx_cube Vk(arma::size(rhok), fill::zeros);
+	if (arma::size(V_initial) == arma::size(rho)) {
+		Vk = fft(V_initial);
+		Vk(0, 0, 0) = 0;
+	}
+
+	cx_cube residual = rhok - apply_operator(Vk);
+	cx_cube direction = residual % preconditioner;
+	double residual_z = real_inner_product(residual, direction);
+	double relative_residual = sqrt(real_inner_product(residual, residual)) / rhok_norm;
+	uword iteration = 0;
+	while ((relative_residual > tolerance) && (iteration < max_iterations)) {
+		++iteration;
+		const cx_cube A_direction = apply_operator(direction);
+		const double step = residual_z / real_inner_product(direction, A_direction);
+		Vk += step * direction;
+		residual -= step * A_direction;
+		const cx_cube z = residual % preconditioner;
+		const double new_residual_z = real_inner_product(residual, z);
+		direction = z + (new_residual_z / residual_z) * direction;
+		residual_z = new_residual_z;
+		relative_residual = sqrt(real_inner_product(residual, residual)) / rhok_norm;
+	}
+
+	if (relative_residual > tolerance) {
+		log->warn("PCG Poisson solver did not converge in {} iterations (relative residual: {}). The dense solver will be used!", iteration, relative_residual);
+		return poisson_solver_3D(rho, diel, lengths, normal_direction, poisson_method::dense);
+	}
+	log->debug("PCG Poisson solver: {} iterations, relative residual: {}", iteration, relative_residual);
+
+	return ifft(Vk);
+}
+
+namespace {
+	// one grid of the multigrid hierarchy: 7-point finite-difference stencil of -div(eps grad(V)) = f with the periodic boundaries
+	// the dielectric profiles are sampled on the grid points along the normal direction
+	struct multigrid_level {
+		urowvec3 n_points;
+		uword normal_direction = 2;
+		// stencil weights of the lower and the upper neighbours along each direction (columns) as functions of the normal coordinate
+		mat lower, upper;
+		vec diagonal;
+		// directions which are coarsened for the next level
+		urowvec3 coarsened = { 0, 0, 0 };
+		cube V, f, residual;
+	};
+
+	// index of the neighbour of i on a periodic grid of size n
+	inline uword periodic_index(const uword& i, const sword& offset, const uword& n) noexcept {
+		return (i + n + offset) % n;
+	}
+
+	// AX = A * X for the stencil of the level
+	void multigrid_apply(const multigrid_level& level, const cube& X, cube& AX) {
+		const uword n0 = level.n_points(0), n1 = level.n_points(1), n2 = level.n_points(2);
+		const uword normal_direction = level.normal_direction;
+		AX.set_size(n0, n1, n2);
+#pragma omp parallel for collapse(2)
+		for (uword k = 0; k < n2; ++k) {
+			for (uword j = 0; j < n1; ++j) {
+				const uword j_m = periodic_index(j, -1, n1), j_p = periodic_index(j, 1, n1);
+				const uword k_m = periodic_index(k, -1, n2), k_p = periodic_index(k, 1, n2);
+				const double* column = X.slice_colptr(k, j);
+				const double* column_ym = X.slice_colptr(k, j_m);
+				const double* column_yp = X.slice_colptr(k, j_p);
+				const double* column_zm = X.slice_colptr(k_m, j);
+				const double* column_zp = X.slice_colptr(k_p, j);
+				double* out = AX.slice_colptr(k, j);
+				for (uword i = 0; i < n0; ++i) {
+					const uword c = (normal_direction == 0) ? i : ((normal_direction == 1) ? j : k);
+					const uword i_m = periodic_index(i, -1, n0), i_p = periodic_index(i, 1, n0);
+					out[i] = level.diagonal(c) * column[i]
+						- level.lower(c, 0) * column[i_m] - level.upper(c, 0) * column[i_p]
+						- level.lower(c, 1) * column_ym[i] - level.upper(c, 1) * column_yp[i]
+						- level.lower(c, 2) * column_zm[i] - level.upper(c, 2) * column_zp[i];
+				}
+			}
+		}
+	}
+
+	// residual = f - A * V
+	void multigrid_residual(multigrid_level& level) {
+		multigrid_apply(level, level.V, level.residual);
+		level.residual = level.f - level.residual;
+	}
+
+	// damped Jacobi sweeps
+	void multigrid_smooth(multigrid_level& level, const uword& sweeps) {
+		const double damping = 0.8;
+		for (uword sweep = 0; sweep < sweeps; ++sweep) {
+			multigrid_residual(level);
+#pragma omp parallel for
+			for (uword k = 0; k < level.V.n_slices; ++k) {
+				for (uword j = 0; j < level.V.n_cols; ++j) {
+					double* column = level.V.slice_colptr(k, j);
+					const double* residual = level.residual.slice_colptr(k, j);
+					for (uword i = 0; i < level.V.n_rows; ++i) {
+						const uword c = (level.normal_direction == 0) ? i : ((level.normal_direction == 1) ? j : k);
+						column[i] += damping * residual[i] / level.diagonal(c);
+					}
+				}
+			}
+		}
+	}
+
+	// full-weighting restriction (1/4, 1/2, 1/4) to every second grid point along the direction
+	cube restrict_along(const cube& fine, const uword& direction) {
+		urowvec3 n_points = SizeVec(fine);
+		const uword n_fine = n_points(direction);
+		n_points(direction) /= 2;
+		cube coarse(as_size(n_points));
+#pragma omp parallel for collapse(2)
+		for (uword k = 0; k < coarse.n_slices; ++k) {
+			for (uword j = 0; j < coarse.n_cols; ++j) {
+				for (uword i = 0; i < coarse.n_rows; ++i) {
+					uword index[3] = { i, j, k };
+					const uword I = 2 * index[direction];
+					index[direction] = periodic_index(I, -1, n_fine);
+					double value = 0.25 * fine(index[0], index[1], index[2]);
+					index[direction] = I;
+					value += 0.5 * fine(index[0], index[1], index[2]);
+					index[direction] = periodic_index(I, 1, n_fine);
+					coarse(i, j, k) = value + 0.25 * fine(index[0], index[1], index[2]);
+				}
+			}
+		}
+		return coarse;
+	}
+
+	// linear interpolation to the grid with twice as many points along the direction
+	cube prolong_along(const cube& coarse, const uword& direction) {
+		urowvec3 n_points = SizeVec(coarse);
+		const uword n_coarse = n_points(direction);
+		n_points(direction) *= 2;
+		cube fine(as_size(n_points));
+#pragma omp parallel for collapse(2)
+		for (uword k = 0; k < fine.n_slices; ++k) {
+			for (uword j = 0; j < fine.n_cols; ++j) {
+				for (uword i = 0; i < fine.n_rows; ++i) {
+					uword index[3] = { i, j, k };
+					const uword I = index[direction] / 2;
+					const bool odd = (index[direction] % 2 == 1);
+					index[direction] = I;
+					double value = coarse(index[0], index[1], index[2]);
+					if (odd) {
+						index[direction] = periodic_index(I, 1, n_coarse);
+						value = 0.5 * (value + coarse(index[0], index[1], index[2]));
+					}
+					fine(i, j, k) = value;
+				}
+			}
+		}
+		return fine;
+	}
+
+	// grids of the multigrid V-cycles:
+	// the directions with an even number of points (at least 4) are coarsened if their grid spacing is less than 1.5 times the smallest one
+	// the coarsening stops when there is no such direction or the grid has less than 512 points
+	vector<multigrid_level> multigrid_hierarchy(mat profiles, const rowvec3& lengths, urowvec3 n_points, const uword& normal_direction) {
+		vector<multigrid_level> levels;
+		while (true) {
+			multigrid_level level;
+			level.n_points = n_points;
+			level.normal_direction = normal_direction;
+			const rowvec3 spacing = lengths / conv_to<rowvec>::from(n_points);
+			const uword N = n_points(normal_direction);
+			level.lower.set_size(N, 3);
+			level.upper.set_size(N, 3);
+			for (uword d = 0; d < 3; ++d) {
+				if (d == normal_direction) {
+					// harmonic average of the dielectric constants on the faces between the grid points
+					for (uword c = 0; c < N; ++c) {
+						const double eps_lower = profiles(periodic_index(c, -1, N), d), eps_upper = profiles(periodic_index(c, 1, N), d);
+						level.lower(c, d) = 2 * eps_lower * profiles(c, d) / (eps_lower + profiles(c, d)) / square(spacing(d));
+						level.upper(c, d) = 2 * eps_upper * profiles(c, d) / (eps_upper + profiles(c, d)) / square(spacing(d));
+					}
+				}
+				else {
+					level.lower.col(d) = profiles.col(d) / square(spacing(d));
+					level.upper.col(d) = level.lower.col(d);
+				}
+			}
+			level.diagonal = sum(level.lower, 1) + sum(level.upper, 1);
+
+			const double smallest_spacing = min(spacing);
+			for (uword d = 0; d < 3; ++d) {
+				level.coarsened(d) = (n_points(d) % 2 == 0) && (n_points(d) >= 4) && (spacing(d) < 1.5 * smallest_spacing);
+			}
+			const bool coarsest = (!any(level.coarsened)) || (prod(n_points) < 512);
+			if (coarsest) {
+				level.coarsened.zeros();
+			}
+			levels.push_back(level);
+			if (coarsest) {
+				break;
+			}
+
+			if (level.coarsened(normal_direction)) {
+				const mat fine_profiles = profiles;
+				profiles.set_size(N / 2, 3);
+				for (uword c = 0; c < N / 2; ++c) {
+					profiles.row(c) = 0.25 * fine_profiles.row(periodic_index(2 * c, -1, N)) + 0.5 * fine_profiles.row(2 * c) + 0.25 * fine_profiles.row(2 * c + 1);
+				}
+			}
+			n_points /= (level.coarsened + 1);
+		}
+		return levels;
+	}
+
+	// conjugate gradient solution of the coarsest grid (relative residual of 1e-8 or 10 iterations per grid point along the longest direction)
+	void multigrid_coarsest_solve(multigrid_level& level) {
+		// the periodic system is only solvable for the zero average of the f
+		level.f -= accu(level.f) / level.f.n_elem;
+		multigrid_residual(level);
+		const double f_norm = norm(vectorise(level.f));
+		cube direction = level.residual, A_direction;
+		double residual_squared = accu(square(level.residual));
+		const uword max_iterations = 10 * max(level.n_points);
+		for (uword iteration = 0; (iteration < max_iterations) && (sqrt(residual_squared) > 1e-8 * f_norm); ++iteration) {
+			multigrid_apply(level, direction, A_direction);
+			const double step = residual_squared / accu(direction % A_direction);
+			level.V += step * direction;
+			level.residual -= step * A_direction;
+			const double new_residual_squared = accu(square(level.residual));
+			direction = level.residual + (new_residual_squared / residual_squared) * direction;
+			residual_squared = new_residual_squared;
+		}
+	}
+
+	// V-cycle from the level "l" to the coarsest grid with 2 pre- and post-smoothing sweeps
+	void multigrid_v_cycle(vector<multigrid_level>& levels, const uword& l) {
+		multigrid_level& level = levels.at(l);
+		if (l + 1 == levels.size()) {
+			multigrid_coarsest_solve(level);
+			return;
+		}
+		multigrid_smooth(level, 2);
+		multigrid_residual(level);
+
+		multigrid_level& coarse = levels.at(l + 1);
+		coarse.f = level.residual;
+		for (uword d = 0; d < 3; ++d) {
+			if (level.coarsened(d)) { coarse.f = restrict_along(coarse.f, d); }
+		}
+		coarse.V.zeros(arma::size(coarse.f));
+		multigrid_v_cycle(levels, l + 1);
+
+		cube correction = coarse.V;
+		for (uword d = 0; d < 3; ++d) {
+			if (level.coarsened(d)) { correction = prolong_along(correction, d); }
+		}
+		level.V += correction;
+		multigrid_smooth(level, 2);
+	}
+}
+
+cx_cube poisson_solver_multigrid(const cx_cube& rho, const mat& diel, const rowvec3& lengths, const uword& normal_direction, const double& tolerance, const cx_cube& V_initial) {
+	const scoped_timer timer("poisson_solver_multigrid");
+	auto log = spdlog::get("loggers");
+	const uword max_cycles = 100;
+	vector<multigrid_level> levels = multigrid_hierarchy(diel, lengths, SizeVec(rho), normal_direction);
+	multigrid_level& grid = levels.front();
+
+	// 4PI is for the atomic units
+	// the average charge is compensated by a uniform background as in the spectral solver (G = 0)
+	grid.f = 4.0 * PI * real(rho);
+	grid.f -= accu(grid.f) / grid.f.n_elem;
+	const double f_norm = norm(vectorise(grid.f));
+	if (f_norm == 0) {
+		return cx_cube(arma::size(rho), fill::zeros);
+	}
+
+	// warm start from the previous potential
+	if (arma::size(V_initial) == arma::size(rho)) {
+		grid.V = real(V_initial);
+	}
+	else {
+		grid.V.zeros(arma::size(grid.f));
+	}
+
+	multigrid_residual(grid);
+	double relative_residual = norm(vectorise(grid.residual)) / f_norm;
+	uword cycle = 0;
+	while ((relative_residual > tolerance) && (cycle < max_cycles)) {
+		++cycle;
+		multigrid_v_cycle(levels, 0);
+		multigrid_residual(grid);
+		relative_residual = norm(vectorise(grid.residual)) / f_norm;
+	}
+
+	if (relative_residual > tolerance) {
+		log->warn("Multigrid Poisson solver did not converge in {} V-cycles (relative residual: {}). The dense solver will be used!", cycle, relative_residual);
+		return poisson_solver_3D(rho, diel, lengths, normal_direction, poisson_method::dense);
+	}
+	log->debug("Multigrid Poisson solver: {} grids (coarsest: {}), {} V-cycles, relative residual: {}", levels.size(), to_string(levels.back().n_points), cycle, relative_residual);
+
+	// 0,0,0 in k-space corresponds to a constant in the real space: average potential over the supercell.
+	grid.V -= accu(grid.V) / grid.V.n_elem;
+	return cx_cube(grid.V, cube(arma::size(grid.V), fill::zeros));
+}
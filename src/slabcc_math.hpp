@@ -7,6 +7,7 @@
 #include "arma_io.hpp"
 #include <fftw3.h>
 #include "general_io.hpp"
+#include "timing.hpp"
 #include "spline.hpp"
 
 #define PI datum::pi
@@ -25,7 +26,7 @@
 
 using namespace arma;
 
-// a (very inefficient) 3D spline interpolation!
+// 3D spline interpolation: cubic splines along x, y, and z (OpenMP parallel over the lines)
 cube interp3(const rowvec& x, const rowvec& y, const rowvec& z, const cube& v, const rowvec& xi, const rowvec& yi, const rowvec& zi);
 cube interp3(const cube& v, const rowvec& xi, const rowvec& yi, const rowvec& zi);
 
@@ -35,13 +36,25 @@ tuple<cube, cube, cube> ndgrid(const rowvec& v1, const rowvec& v2, const rowvec&
 //3D meshgrid
 tuple<cube, cube, cube> meshgrid(const rowvec& v1, const rowvec& v2, const rowvec& v3);
 
+//resamples a periodic real data on a new grid size by zero-padding/truncation of its Fourier components
+//data_k: fft of the data
+cube fourier_resample(const cx_cube& data_k, const urowvec3& new_size);
+
 //shifts a cube by a relative 3D vector [0 1]
-cube shift(cube cube_in, rowvec3 shifts);
+cube shift(const cube& cube_in, rowvec3 shifts);
 
 //Planar average of a cube in the defined direction
 //direction: 0,1,2 > x,y,z
 vec planar_average(const uword& direction, const cube& cube_in);
 
+//sums of the cube elements on the planes normal to the x, y, and z directions
+//(same as the planar_average in all directions but in a single pass over the cube)
+tuple<vec, vec, vec> planar_sums(const cube& cube_in);
+
+//root mean square of the difference: real(data) * scale - reference
+//(fused reduction without any temporary cubes)
+double rms_difference(const cx_cube& data, const double& scale, const cube& reference);
+
 
 //1D FFT of complex data.
 //no normalization for forward FFT
@@ -89,11 +102,82 @@ inline double square(const double& input) noexcept {
 }
 
 
+//solves A * X = B for a Hermitian positive definite A with the Cholesky factorization
+//only the upper triangle of the A is used. Falls back to the general solver if A is not positive definite
+void solve_hpd(cx_mat& X, const cx_mat& A, const cx_mat& B);
+
+//solves A * X = B for a Hermitian positive definite A with the Cholesky factorization in the single precision
+//and iterative refinement of the solution in the double precision
+//relative_residual: achieved norm(B - A * X) / norm(B)
+//returns false if the refinement did not converge and the system is solved with the solve_hpd instead
+bool solve_hpd_mixed(cx_mat& X, const cx_mat& A, const cx_mat& B, double& relative_residual);
+
+//solvers for the linear systems of the Poisson equation in the k-space
+enum class poisson_method :int {
+	dense,		// Cholesky factorization of the dense matrices
+	banded,		// Cholesky factorization of the band matrices from the truncated Fourier series of the dielectric profiles
+	pcg,		// matrix-free preconditioned conjugate gradient (poisson_solver_pcg)
+	mixed,		// Cholesky factorization of the dense matrices in the single precision with iterative refinement
+	multigrid	// geometric multigrid solver of the finite-difference discretization in the real space (poisson_solver_multigrid)
+};
+
 //Poisson solver in 3D with anisotropic dielectric profiles
 //diel is the N*3 matrix of variations in dielectric tensor elements in direction normal to the surface
-cx_cube poisson_solver_3D(const cx_cube& rho, mat diel, rowvec3 lengths, uword normal_direction);
+//tolerance: truncation threshold of the dielectric Fourier components relative to their average (banded method),
+//			or the relative residual (pcg and multigrid methods)
+cx_cube poisson_solver_3D(const cx_cube& rho, mat diel, rowvec3 lengths, uword normal_direction, const poisson_method& method = poisson_method::dense, const double& tolerance = 0);
+
+//Poisson solver for a stack of charge densities (e.g. the separate Gaussian charges of a model) with the same dielectric profiles
+//each system is factorized once and solved for all the densities together
+vector<cx_cube> poisson_solver_3D(const vector<cx_cube>& rho, mat diel, rowvec3 lengths, uword normal_direction, const poisson_method& method = poisson_method::dense, const double& tolerance = 0);
+
+//matrix-free preconditioned conjugate gradient solver of the Poisson equation with the same inputs and outputs as the poisson_solver_3D
+//the operator is applied by the FFTs and the multiplication by the dielectric profiles: O(N log N) per iteration
+//the preconditioner is the inverse of the operator for the average dielectric tensor
+//iterations start from the V_initial if it has the same size as the rho (warm start)
+//tolerance: relative residual. Falls back to the dense solver if it does not converge
+cx_cube poisson_solver_pcg(const cx_cube& rho, const mat& diel, const rowvec3& lengths, const uword& normal_direction, const double& tolerance, const cx_cube& V_initial);
+
+//geometric multigrid solver of the Poisson equation with the same inputs and outputs as the poisson_solver_pcg
+//the equation is discretized by the 7-point finite-difference stencil in the real space with the dielectric profiles on the grid points
+//V-cycles with the damped Jacobi smoothing and the conjugate gradient solution of the coarsest grid: O(N) per V-cycle
+//the finite-difference potential differs from the spectral one by the discretization error
+//tolerance: relative residual. Falls back to the dense solver if it does not converge
+cx_cube poisson_solver_multigrid(const cx_cube& rho, const mat& diel, const rowvec3& lengths, const uword& normal_direction, const double& tolerance, const cx_cube& V_initial);
+
+
+
+//generate a copy of the cube with the elements cyclically shifted by N(0), N(1), N(2) positions along the rows, columns, and slices
+//all 3 axes are shifted in a single pass: each column of the output is assembled from 2 contiguous segments of a column of the input
+template <typename T>
+Cube<T> shift(const Cube<T>& A, const irowvec3& N) {
+	Cube<T> B(arma::size(A));
+	if (A.is_empty()) {
+		return B;
+	}
 
+	// equivalent positive shift: [0, size)
+	const auto positive_shift = [](const sword& n, const uword& size) noexcept {
+		const sword remainder = n % static_cast<sword>(size);
+		return static_cast<uword>(remainder < 0 ? remainder + static_cast<sword>(size) : remainder);
+	};
+	const uword N0 = positive_shift(N(0), A.n_rows);
+	const uword N1 = positive_shift(N(1), A.n_cols);
+	const uword N2 = positive_shift(N(2), A.n_slices);
+
+	for (uword k = 0; k < A.n_slices; ++k) {
+		const uword k_source = (k + A.n_slices - N2) % A.n_slices;
+		for (uword j = 0; j < A.n_cols; ++j) {
+			const uword j_source = (j + A.n_cols - N1) % A.n_cols;
+			const T* source = A.slice_colptr(k_source, j_source);
+			T* destination = B.slice_colptr(k, j);
+			copy(source, source + A.n_rows - N0, destination + N0);
+			copy(source + A.n_rows - N0, source + A.n_rows, destination);
+		}
+	}
 
+	return B;
+}
 
 //generate a copy of the cube with the elements shifted by N positions along:
 //dim=0: each row
@@ -101,19 +185,9 @@ cx_cube poisson_solver_3D(const cx_cube& rho, mat diel, rowvec3 lengths, uword n
 //dim=2: each slice
 template <typename T>
 Cube<T> shift(const Cube<T>& A, const sword& N, const uword& dim) {
-	Cube<T> B(arma::size(A));
-	const auto index_init = regspace<uvec>(0, A.n_elem - 1);
-	imat sub_shift = conv_to<imat>::from(ind2sub(arma::size(A), index_init));
-	const uword size = arma::size(A)(dim);
-	sub_shift.row(dim).for_each([&N, &size](sword& i) noexcept {
-		i += N;
-		while (i < 0) i += size;
-		i = i % size;
-	});
-
-	B(sub2ind(arma::size(A), conv_to<umat>::from(sub_shift))) = A(index_init);
-
-	return B;
+	irowvec3 shifts = { 0, 0, 0 };
+	shifts(dim) = N;
+	return shift(A, shifts);
 }
 
 //Undo a fftshift
@@ -124,12 +198,9 @@ Row<T> ifftshift(const Row<T> &A) {
 
 //Undo a fftshift
 template <typename T>
-Cube<T> ifftshift(Cube<T> A) {
-	for (uword i = 0; i < 3; ++i) {
-		A = shift(A, -1 * (arma::size(A)(i) / 2), i);
-	}
-
-	return A;
+Cube<T> ifftshift(const Cube<T>& A) {
+	const irowvec3 shifts = { -static_cast<sword>(A.n_rows / 2), -static_cast<sword>(A.n_cols / 2), -static_cast<sword>(A.n_slices / 2) };
+	return shift(A, shifts);
 }
 
 //returns the size of a cube as a rowvec
@@ -16,6 +16,23 @@ void slabcc_model::set_input_variables(const input_data& inputfile_variables) {
 	charge_rotations = inputfile_variables.charge_rotations;
 	charge_fraction = inputfile_variables.charge_fraction;
 	trivariate_charge = inputfile_variables.trivariate;
+	potential_resampling = (inputfile_variables.potential_resampling == "fourier") ? resampling_method::fourier : resampling_method::spline;
+	if (inputfile_variables.poisson_solver == "banded") {
+		poisson_solver = poisson_method::banded;
+	}
+	else if (inputfile_variables.poisson_solver == "pcg") {
+		poisson_solver = poisson_method::pcg;
+	}
+	else if (inputfile_variables.poisson_solver == "mixed") {
+		poisson_solver = poisson_method::mixed;
+	}
+	else if (inputfile_variables.poisson_solver == "multigrid") {
+		poisson_solver = poisson_method::multigrid;
+	}
+	else {
+		poisson_solver = poisson_method::dense;
+	}
+	poisson_tolerance = inputfile_variables.poisson_tol;
 	set_model_type(inputfile_variables.model_2D, diel_in, diel_out);
 };
 
@@ -77,9 +94,10 @@ void slabcc_model::update_cell_vectors_lengths() {
 }
 
 void slabcc_model::dielectric_profiles_gen() {
+	const scoped_timer timer("dielectric_profiles_gen");
 	const auto length = cell_vectors_lengths(normal_direction);
 	const auto n_points = cell_grid(normal_direction);
-	rowvec2 interfaces_cartesian = interfaces * length;
+	rowvec2 interfaces_cartesian = (interfaces - grid_offset(normal_direction)) * length;
 	interfaces_cartesian = sort(interfaces_cartesian);
 	const auto positions = linspace<rowvec>(0, length, n_points + 1);
 	dielectric_profiles = arma::zeros<mat>(n_points, 3);
@@ -107,6 +125,7 @@ void slabcc_model::dielectric_profiles_gen() {
 }
 
 void slabcc_model::gaussian_charges_gen() {
+	const scoped_timer timer("gaussian_charges_gen");
 
 	do {
 		rowvec x0 = linspace<rowvec>(0, cell_vectors_lengths(0) - cell_vectors_lengths(0) / cell_grid(0), cell_grid(0));
@@ -117,9 +136,10 @@ void slabcc_model::gaussian_charges_gen() {
 
 		for (uword i = 0; i < charge_fraction.n_elem; ++i) {
 			// shift the axis reference to position of the Gaussian charge center
-			rowvec x = x0 - accu(cell_vectors.col(0) * charge_position(i, 0));
-			rowvec y = y0 - accu(cell_vectors.col(1) * charge_position(i, 1));
-			rowvec z = z0 - accu(cell_vectors.col(2) * charge_position(i, 2));
+			const rowvec3 grid_position = fmod_p(charge_position.row(i) - grid_offset, 1);
+			rowvec x = x0 - accu(cell_vectors.col(0) * grid_position(0));
+			rowvec y = y0 - accu(cell_vectors.col(1) * grid_position(1));
+			rowvec z = z0 - accu(cell_vectors.col(2) * grid_position(2));
 			//handle the minimum distance from the mirror charges
 			for (auto& pos : x) {
 				if (abs(pos) > cell_vectors_lengths(0) / 2) {
@@ -379,14 +399,13 @@ bool slabcc_model::had_discretization_error() {
 		log->critical("Increasing the calculation grid size did not decrease the discretization error. Most probably the model charge is fairly delocalized!");
 
 		if (is_active(verbosity::write_planarAvg_file)) {
-			write_planar_avg(real(POT) * Hartree_to_eV, real(CHG) * voxel_vol, "M",  cell_vectors_lengths);
+			write_planar_avg(real(POT) * Hartree_to_eV, real(CHG) * voxel_vol, output_id + "M",  cell_vectors_lengths);
 		}
 		else if (is_active(verbosity::write_normal_planarAvg)) {
-			write_planar_avg(real(POT) * Hartree_to_eV, real(CHG) * voxel_vol, "M", cell_vectors_lengths, normal_direction);
+			write_planar_avg(real(POT) * Hartree_to_eV, real(CHG) * voxel_vol, output_id + "M", cell_vectors_lengths, normal_direction);
 		}
 
-		finalize_loggers();
-		exit(1);
+		throw slabcc_error("Increasing the calculation grid size did not decrease the discretization error.");
 	}
 	else {
 		if (new_charge_error > tolerance) {
@@ -395,7 +414,9 @@ bool slabcc_model::had_discretization_error() {
 			const rowvec3 new_grid_size = 1.5 * conv_to<rowvec>::from(cell_grid);
 			const urowvec3 new_grid = { (uword)new_grid_size(0), (uword)new_grid_size(1), (uword)new_grid_size(2) };
 			change_grid(new_grid);
-			log->debug("New model charge grid size: {}", to_string(cell_grid));
+			if (log->should_log(spdlog::level::debug)) {
+				log->debug("New model charge grid size: {}", to_string(cell_grid));
+			}
 			return true;
 		}
 		else {
@@ -406,20 +427,63 @@ bool slabcc_model::had_discretization_error() {
 }
 
 void slabcc_model::update_V_target() {
+	const scoped_timer timer("update_V_target");
 	auto log = spdlog::get("loggers");
 	if (as_size(cell_grid) != arma::size(POT_target)) {
-		POT_target.set_size(as_size(cell_grid));
-		const rowvec new_grid_x = linspace<rowvec>(1.0, POT_target_on_input_grid.n_rows, cell_grid(0));
-		const rowvec new_grid_y = linspace<rowvec>(1.0, POT_target_on_input_grid.n_cols, cell_grid(1));
-		const rowvec new_grid_z = linspace<rowvec>(1.0, POT_target_on_input_grid.n_slices, cell_grid(2));
+		if (POT_target_cache && POT_target_cache->find(potential_resampling, cell_grid, POT_target)) {
+			log->debug("Resampled potential has been reused for the grid size: " + to_string(cell_grid));
+			return;
+		}
+		if (potential_resampling == resampling_method::fourier) {
+			// the forward FFT is done once for all the regrids
+			if (arma::size(POT_target_on_input_grid_k) != arma::size(POT_target_on_input_grid)) {
+				POT_target_on_input_grid_k = fft(POT_target_on_input_grid);
+			}
+			POT_target = fourier_resample(POT_target_on_input_grid_k, cell_grid);
+		}
+		else {
+			const rowvec new_grid_x = linspace<rowvec>(1.0, POT_target_on_input_grid.n_rows, cell_grid(0));
+			const rowvec new_grid_y = linspace<rowvec>(1.0, POT_target_on_input_grid.n_cols, cell_grid(1));
+			const rowvec new_grid_z = linspace<rowvec>(1.0, POT_target_on_input_grid.n_slices, cell_grid(2));
 
-		POT_target = interp3(POT_target_on_input_grid, new_grid_x, new_grid_y, new_grid_z);
+			POT_target = interp3(POT_target_on_input_grid, new_grid_x, new_grid_y, new_grid_z);
+		}
 		POT_target -= accu(POT_target) / POT_target.n_elem;
-		log->debug("New potential grid size: " + to_string(SizeVec(POT_target)));
+		if (POT_target_cache) {
+			POT_target_cache->store(potential_resampling, cell_grid, POT_target);
+		}
+		if (log->should_log(spdlog::level::debug)) {
+			log->debug("New potential grid size: " + to_string(SizeVec(POT_target)));
+		}
+	}
+}
+
+bool resampled_potentials::find(const resampling_method& method, const urowvec3& grid, cube& potential) {
+	const lock_guard<mutex> lock(potentials_mutex);
+	const auto found = potentials.find(make_tuple(method, grid(0), grid(1), grid(2)));
+	if (found == potentials.end()) {
+		return false;
 	}
+	potential = found->second;
+	return true;
+}
+
+void resampled_potentials::store(const resampling_method& method, const urowvec3& grid, const cube& potential) {
+	const lock_guard<mutex> lock(potentials_mutex);
+	potentials[make_tuple(method, grid(0), grid(1), grid(2))] = potential;
+}
+
+double resampled_potentials::memory() {
+	const lock_guard<mutex> lock(potentials_mutex);
+	double bytes = 0;
+	for (const auto& potential : potentials) {
+		bytes += sizeof(double) * static_cast<double>(potential.second.n_elem);
+	}
+	return bytes;
 }
 
 void slabcc_model::adjust_extrapolation_grid(const int &extrapol_steps_num, const double &extrapol_steps_size) {
+	const scoped_timer timer("adjust_extrapolation_grid");
 
 	auto log = spdlog::get("loggers");
 	log->trace("Checking the extrapolation grid size");
@@ -437,6 +501,7 @@ void slabcc_model::adjust_extrapolation_grid(const int &extrapol_steps_num, cons
 }
 
 tuple <rowvec, rowvec> slabcc_model::extrapolate(int extrapol_steps_num, double extrapol_steps_size) {
+	const scoped_timer timer("extrapolate");
 
 	auto log = spdlog::get("loggers");
 	const mat33 cell_vectors0 = cell_vectors;
@@ -446,6 +511,7 @@ tuple <rowvec, rowvec> slabcc_model::extrapolate(int extrapol_steps_num, double
 	const double slab_thickness = abs(interfaces(0) - interfaces(1));
 	rowvec Es = arma::zeros<rowvec>(extrapol_steps_num - 1), sizes = Es;
 	for (auto n = 0; n < extrapol_steps_num - 1; ++n) {
+		const trace_scope trace("extrapolation step " + to_string(n + 1));
 		const double extrapol_factor = extrapol_steps_size * (1.0 + n) + 1;
 		change_size(cell_vectors0 * extrapol_factor);
 		if (this->type == model_type::slab) {
@@ -470,14 +536,16 @@ tuple <rowvec, rowvec> slabcc_model::extrapolate(int extrapol_steps_num, double
 
 		// (only works for the orthogonal cells!)
 		const auto CHG_normalized = CHG - total_charge / prod(cell_vectors_lengths);
-		const auto V = poisson_solver_3D(CHG_normalized, dielectric_profiles, cell_vectors_lengths, normal_direction);
+		const auto V = solve_poisson(CHG_normalized);
 		const auto EperModel = 0.5 * accu(real(V % CHG_normalized)) * voxel_vol * Hartree_to_eV;
-		const rowvec2 interface_pos = interfaces * cell_vectors_lengths(normal_direction);
-		string extrapolation_info = to_string(extrapol_factor) + "\t" + ::to_string(EperModel) + "\t" + ::to_string(total_charge) + "\t" + to_string(interface_pos);
-		for (uword i = 0; i < charge_position.n_rows; ++i) {
-			extrapolation_info += "\t" + to_string(charge_position(i, normal_direction) * cell_vectors_lengths(normal_direction));
+		if (log->should_log(spdlog::level::debug)) {
+			const rowvec2 interface_pos = interfaces * cell_vectors_lengths(normal_direction);
+			string extrapolation_info = to_string(extrapol_factor) + "\t" + ::to_string(EperModel) + "\t" + ::to_string(total_charge) + "\t" + to_string(interface_pos);
+			for (uword i = 0; i < charge_position.n_rows; ++i) {
+				extrapolation_info += "\t" + to_string(charge_position(i, normal_direction) * cell_vectors_lengths(normal_direction));
+			}
+			log->debug(extrapolation_info);
 		}
-		log->debug(extrapolation_info);
 		Es(n) = EperModel;
 		sizes(n) = 1.0 / extrapol_factor;
 	}
@@ -486,6 +554,7 @@ tuple <rowvec, rowvec> slabcc_model::extrapolate(int extrapol_steps_num, double
 }
 
 double slabcc_model::Eiso_bessel() const {
+	const scoped_timer timer("Eiso_bessel");
 	
 	auto logger = spdlog::get("loggers");
 	const double K_min = 0.00001;
@@ -511,6 +580,7 @@ double slabcc_model::Eiso_bessel() const {
 }
 
 rowvec slabcc_model::Uk(rowvec k) const {
+	const scoped_timer timer("Uk");
 	const double z0 = charge_position(0, normal_direction) * cell_vectors_lengths(normal_direction);
 	const rowvec3 length = cell_vectors_lengths;
 	const urowvec3 n_points = cell_grid;
@@ -538,26 +608,56 @@ rowvec slabcc_model::Uk(rowvec k) const {
 	rowvec Uk = zeros(arma::size(k));
 
 	const cx_mat Ag12 = Ag1 % Ag2;
-	const auto cosGL_2 = cos(Gz0 * length(normal) / 2.0);
+	const rowvec cosGL_2 = cos(Gz0 * length(normal) / 2.0);
+	double max_residual = 0;
 	for (uword i = 0; i < k.n_elem; ++i) {
 		const cx_mat Ag = Ag12 + Ag1p * k(i) * k(i);
 		const double keff = k(i);
 		const mat Kinvg = diagmat(dielbulk * length(normal) * (pow(keff, 2) + Gz02) / (1 - exp(-keff * length(normal) / 2.0) * cosGL_2));
 		const cx_mat Dg = Kinvg + length(normal) * Ag;
-		const auto VGz = solve(Dg, rhok_t);
-		const auto Vz = ifft(VGz) * LGz;
+		cx_mat VGz;
+		if (poisson_solver == poisson_method::mixed) {
+			double residual = 0;
+			solve_hpd_mixed(VGz, Dg, rhok_t, residual);
+			max_residual = max(max_residual, residual);
+		}
+		else {
+			solve_hpd(VGz, Dg, rhok_t);
+		}
+		const cx_mat Vz = ifft(VGz) * LGz;
 		Uk(i) = real(accu(Vz % rho));
 	}
 
+	if (poisson_solver == poisson_method::mixed) {
+		auto log = spdlog::get("loggers");
+		log->debug("Mixed precision solver in Uk: largest relative residual {}", max_residual);
+	}
+
 	return Uk;
 }
 
+cx_cube slabcc_model::solve_poisson(const cx_cube& charge) const {
+	if (poisson_solver == poisson_method::pcg) {
+		return poisson_solver_pcg(charge, dielectric_profiles, cell_vectors_lengths, normal_direction, poisson_tolerance, POT);
+	}
+	if (poisson_solver == poisson_method::multigrid) {
+		// the finite-difference potentials are only used in the optimization: the final potential and the energies are calculated by the spectral solver
+		if (in_optimization) {
+			return poisson_solver_multigrid(charge, dielectric_profiles, cell_vectors_lengths, normal_direction, poisson_tolerance, POT);
+		}
+		return poisson_solver_3D(charge, dielectric_profiles, cell_vectors_lengths, normal_direction);
+	}
+	return poisson_solver_3D(charge, dielectric_profiles, cell_vectors_lengths, normal_direction, poisson_solver, poisson_tolerance);
+}
+
 double potential_error(const vector<double>& x, vector<double>& grad, void* model_ptr) {
 	slabcc_model& model = *static_cast<slabcc_model*>(model_ptr);
+	const trace_scope trace(model.in_optimization ? "optimizer evaluation" : "model potential evaluation");
 	return model.potential_error(x, grad);
 }
 
 double slabcc_model::potential_error(const vector<double>& x, vector<double>& grad) {
+	const scoped_timer timer("potential_error");
 	auto log = spdlog::get("loggers");
 
 	data_unpacker(x);
@@ -575,16 +675,33 @@ double slabcc_model::potential_error(const vector<double>& x, vector<double>& gr
 	gaussian_charges_gen();
 	dielectric_profiles_gen();
 
-	POT = poisson_solver_3D(CHG, dielectric_profiles, cell_vectors_lengths, normal_direction);
-	POT_diff = real(POT) * Hartree_to_eV - POT_target;
+	POT = solve_poisson(CHG);
 	//bigger output for out-of-bounds input: quadratic penalty
 	const double bounds_correction = bounds_factor + 10 * bounds_factor * bounds_factor;
-	potential_RMSE = sqrt(accu(square(POT_diff)) /POT_diff.n_elem) + bounds_correction;
+	potential_RMSE = rms_difference(POT, Hartree_to_eV, POT_target) + bounds_correction;
+
+	// the potential difference is only needed after the optimization (check_V_error, dV)
+	if (!in_optimization) {
+		POT_diff = real(POT) * Hartree_to_eV - POT_target;
+
+		// discretization error of the finite-difference potentials which were used in the optimization
+		if ((poisson_solver == poisson_method::multigrid) && log->should_log(spdlog::level::debug)) {
+			const cx_cube POT_multigrid = poisson_solver_multigrid(CHG, dielectric_profiles, cell_vectors_lengths, normal_direction, poisson_tolerance, POT);
+			const cube POT_spectral = real(POT) * Hartree_to_eV;
+			const double difference = rms_difference(POT_multigrid, Hartree_to_eV, POT_spectral);
+			log->debug("Multigrid Poisson solver: RMS difference to the spectral solver: {} eV (relative: {})", difference, difference / sqrt(accu(square(POT_spectral)) / POT_spectral.n_elem));
+		}
+	}
 
 	if (initial_potential_RMSE < 0) {
 		initial_potential_RMSE = potential_RMSE;
 	}
 
+	// this is called in every optimization step: the parameters are formatted only if they are going to be logged
+	if (!log->should_log(spdlog::level::debug)) {
+		return potential_RMSE;
+	}
+
 	log->debug("-----------------------------------------");
 	if (this->type != model_type::bulk) {
 		const rowvec2 unshifted_interfaces = fmod_p(interfaces - rounded_relative_shift(normal_direction), 1);
@@ -618,6 +735,7 @@ double slabcc_model::potential_error(const vector<double>& x, vector<double>& gr
 }
 
 void slabcc_model::optimize(const string& opt_algo, const double& opt_tol, const int& max_eval, const int& max_time, const opt_switches& optimize) {
+	const scoped_timer timer("optimize");
 
 	auto log = spdlog::get("loggers");
 	in_optimization = true;
@@ -674,6 +792,7 @@ void slabcc_model::optimize(const string& opt_algo, const double& opt_tol, const
 }
 
 void slabcc_model::check_V_error() {
+	const scoped_timer timer("check_V_error");
 	auto log = spdlog::get("loggers");
 
 	const bool isotropic_screening = accu(abs(diff(diel_in))) < 0.02;
@@ -687,14 +806,15 @@ void slabcc_model::check_V_error() {
 		}
 	}
 
-	const auto V_error_x = planar_average(0, POT_diff);
-	const auto V_error_y = planar_average(1, POT_diff);
-	const auto V_error_z = planar_average(2, POT_diff);
+	vec V_error_x, V_error_y, V_error_z;
+	tie(V_error_x, V_error_y, V_error_z) = planar_sums(POT_diff);
 
 	//potential error in each direction
 	rowvec3 V_error_planars = { accu(square(V_error_x)), accu(square(V_error_y)), accu(square(V_error_z)) };
 	V_error_planars = sqrt(V_error_planars / POT_diff.n_elem);
-	log->debug("Directional RMSE: " + to_string(V_error_planars));
+	if (log->should_log(spdlog::level::debug)) {
+		log->debug("Directional RMSE: " + to_string(V_error_planars));
+	}
 	if (max(V_error_planars) / min(V_error_planars) > 10) {
 		log->warn("The potential error is highly anisotropic.");
 		log->warn("If the potential error is large, this usually means that either the extra charge is not properly described by the model Gaussian charge "
@@ -706,23 +826,36 @@ void slabcc_model::check_V_error() {
 }
 
 void slabcc_model::verify_CHG(const cube& defect_charge) {
+	const scoped_timer timer("verify_CHG");
 	auto log = spdlog::get("loggers");
 
 	if (this->type != model_type::bulk) {
 
-		//find the index of the interfaces
+		//find the index of the interfaces in the centered model coordinates
 
 		rowvec2 interfaces_index = cell_grid(normal_direction) * interfaces;
 		urowvec2 interfaces_grid_i = { (uword)interfaces_index(0), (uword)interfaces_index(1)};
 		interfaces_grid_i = sort(interfaces_grid_i);
-		vector<span> spans = { span(), span(), span(interfaces_grid_i(0),interfaces_grid_i(1)) };
-		swap(spans[normal_direction], spans[2]);
-		const double model_total = accu(real(CHG)) * voxel_vol;
-		const double model_in = accu(real(CHG(spans[0], spans[1], spans[2]))) * voxel_vol;
+
+		//planes of the grids inside the slab
+		const double n_planes = cell_grid(normal_direction);
+		const double offset = round(grid_offset(normal_direction) * n_planes);
+		const cube model_charge = real(CHG);
+		double model_in = 0, defect_in = 0;
+		for (uword k = interfaces_grid_i(0); k <= interfaces_grid_i(1); ++k) {
+			const uword grid_k = static_cast<uword>(fmod_p(k - offset, n_planes));
+			vector<span> spans = { span(), span(), span(grid_k) };
+			swap(spans[normal_direction], spans[2]);
+			model_in += accu(model_charge(spans[0], spans[1], spans[2]));
+			defect_in += accu(defect_charge(spans[0], spans[1], spans[2]));
+		}
+		model_in *= voxel_vol;
+		defect_in *= voxel_vol;
+
+		const double model_total = accu(model_charge) * voxel_vol;
 		const double model_out = model_total - model_in;
 
 		const double defect_total = accu(defect_charge) * voxel_vol;
-		const double defect_in = accu(defect_charge(spans[0], spans[1], spans[2])) * voxel_vol;
 		const double defect_out = defect_total - defect_in;
 
 		//these two do NOT need to closely agree with each other!
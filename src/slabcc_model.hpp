@@ -22,6 +22,30 @@ enum class model_type :int {
 	slab, bulk, monolayer
 };
 
+// resampling of the target potential on the model grids
+enum class resampling_method :int {
+	spline,		// tricubic spline interpolation
+	fourier		// zero-padding/truncation of the Fourier components
+};
+
+// target potentials of a defect resampled on the model grids (POT_target)
+// shared by the calculations with the same neutral and charged supercells (serve mode)
+class resampled_potentials {
+public:
+	// copies the potential which has been resampled on the grid with the method before
+	// returns false if there is no such potential
+	bool find(const resampling_method& method, const urowvec3& grid, cube& potential);
+
+	void store(const resampling_method& method, const urowvec3& grid, const cube& potential);
+
+	// memory of the stored potentials (bytes)
+	double memory();
+
+private:
+	mutex potentials_mutex;
+	map<tuple<resampling_method, uword, uword, uword>, cube> potentials;
+};
+
 struct slabcc_model {
 
 	bool in_optimization = false;
@@ -39,7 +63,8 @@ struct slabcc_model {
 	rowvec diel_in;								// diagonal elements of slab dielectric tensor
 	rowvec diel_out;							// diagonal elements of enviroment dielectric tensor
 	double diel_erf_beta = 1;
-	rowvec3 rounded_relative_shift = {0,0,0};
+	rowvec3 rounded_relative_shift = {0,0,0};	// shift of the slab center to the middle of the cell (relative, rounded to the input grid voxels)
+	rowvec3 grid_offset = {0,0,0};				// origin of the generated grids in the centered model coordinates (relative, integer number of the input grid voxels)
 
 	// extra charge info
 	mat charge_position;			// center of each Gaussian model charge
@@ -68,6 +93,21 @@ struct slabcc_model {
 	//original target potential of the extra charge in the input files (eV)
 	cube POT_target_on_input_grid;
 
+	//FFT of the POT_target_on_input_grid (cached for the fourier resampling)
+	cx_cube POT_target_on_input_grid_k;
+
+	resampling_method potential_resampling = resampling_method::spline;
+
+	//resampled POT_targets of the previous calculations of the same supercells (optional)
+	shared_ptr<resampled_potentials> POT_target_cache;
+
+	// added to the names of the written files after the "slabcc_"
+	string output_id = "";
+
+	// solver of the Poisson equation and its tolerance
+	poisson_method poisson_solver = poisson_method::dense;
+	double poisson_tolerance = 1e-6;
+
 	
 	mat dielectric_profiles;
 
@@ -82,6 +122,7 @@ struct slabcc_model {
 	void change_size(const mat33& new_cell_vectors);
 
 	//updates the POT_target from the POT_target_on_input_grid to the model grid size
+	//using the potential_resampling method (or from the POT_target_cache)
 	void update_V_target();
 
 	// must be checked before!
@@ -92,10 +133,12 @@ struct slabcc_model {
 
 	// generates dielectric profile matrix with each column representing the 
 	// dielectric tensor elements' variation in the normal direction.
+	// the interfaces are translated by the grid_offset
 	void dielectric_profiles_gen();
 
 	// produces Gaussian charge distribution in real space
 	// the generated charge distribution data is in (e/bohr^3)
+	// the charge positions are translated by the grid_offset
 	void gaussian_charges_gen();
 
 	//pack the optimization variable structure and their lower and upper boundaries into std::vector<double> for NLOPT
@@ -131,15 +174,22 @@ struct slabcc_model {
 	// reference to the variables to be optimized: "opt_vars"
 	void optimize(const string& opt_algo, const double& opt_tol, const int& max_eval, const int& max_time, const opt_switches& optimize);
 
-	//calculates local: POT, POT_diff, rhoM (without jellium), diels, Q
+	//calculates local: POT, POT_diff (only outside the optimization), rhoM (without jellium), diels, Q
 	//returns: root mean squared error (RMSE) of the model charge potential 
 	double potential_error(const vector<double>& x, vector<double>& grad);
 
+	//potential of a charge distribution in the model dielectric profiles with the selected poisson_solver
+	//the pcg and multigrid solvers start from the potential of the previous evaluation (POT)
+	//the multigrid solver is only used in the optimization, otherwise the potential is calculated by the dense solver
+	cx_cube solve_poisson(const cx_cube& charge) const;
+
 	//checks the potential_RMSE and its directional values
 	void check_V_error();
 
-private:
+	// interaction energy kernel of the 2D model in k-space (used in the Eiso_bessel)
 	rowvec Uk(rowvec k) const;
+
+private:
 	//updates the voxel_vol from the "cell_vectors_lengths" and "cell_grid"
 	void update_voxel_vol();
 	//updates the cell_vectors_lengths from the cell_vectors
@@ -0,0 +1,223 @@
+// Copyright (c) 2018-2019, University of Bremen, M. Farzalipour Tabriz
+// Copyrights licensed under the 2-Clause BSD License.
+// See the accompanying LICENSE.txt file for terms.
+
+#include "slabcc_mpi.hpp"
+#ifdef SLABCC_MPI
+
+namespace {
+	enum class mpi_command :int {
+		stop, poisson_solve
+	};
+
+	int mpi_rank = 0;
+	bool mpi_active = false;
+
+	// swaps the normal direction of the cube with its third direction
+	// the swap is its own inverse
+	cx_cube swap_normal_axis(const cx_cube& X, const uword& normal_direction) {
+		if (normal_direction == 2) { return X; }
+		cx_cube Y;
+		if (normal_direction == 0) {
+			Y.set_size(X.n_slices, X.n_cols, X.n_rows);
+#pragma omp parallel for collapse(2)
+			for (uword k = 0; k < X.n_slices; ++k) {
+				for (uword j = 0; j < X.n_cols; ++j) {
+					for (uword i = 0; i < X.n_rows; ++i) {
+						Y(k, j, i) = X(i, j, k);
+					}
+				}
+			}
+		}
+		else {
+			Y.set_size(X.n_rows, X.n_slices, X.n_cols);
+#pragma omp parallel for collapse(2)
+			for (uword k = 0; k < X.n_slices; ++k) {
+				for (uword j = 0; j < X.n_cols; ++j) {
+					for (uword i = 0; i < X.n_rows; ++i) {
+						Y(i, k, j) = X(i, j, k);
+					}
+				}
+			}
+		}
+		return Y;
+	}
+
+	// Poisson solve on all the ranks for the problem defined on the first rank
+	// rho, diel, lengths: inputs of the first rank with the normal direction along z (ignored on the other ranks)
+	// Each rank gets a slab of the z planes of the charge densities. After the forward FFT (transposed output),
+	// it holds all the Gx and Gz of a slab of the Gy: [Gy][Gz][Gx] in the row-major order of the FFTW.
+	// returns the potentials on the first rank and nothing on the other ranks
+	vector<cx_cube> distributed_poisson_solve(const vector<cx_cube>& rho, mat diel, rowvec3 lengths) {
+		const scoped_timer timer("distributed Poisson solve");
+		const bool root = (mpi_rank == 0);
+
+		// grid size and the number of the charge densities
+		unsigned long long sizes[4] = { 0, 0, 0, 0 };
+		if (root) {
+			sizes[0] = rho.front().n_rows;
+			sizes[1] = rho.front().n_cols;
+			sizes[2] = rho.front().n_slices;
+			sizes[3] = rho.size();
+		}
+		MPI_Bcast(sizes, 4, MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD);
+		const uword Nx = sizes[0], Ny = sizes[1], Nz = sizes[2], n_rhs = sizes[3];
+		if (!root) {
+			diel.set_size(Nz, 3);
+		}
+		MPI_Bcast(diel.memptr(), diel.n_elem, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+		MPI_Bcast(lengths.memptr(), 3, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+		ptrdiff_t local_n0 = 0, local_0_start = 0, local_n1 = 0, local_1_start = 0;
+		const ptrdiff_t alloc_local = fftw_mpi_local_size_3d_transposed(Nz, Ny, Nx, MPI_COMM_WORLD, &local_n0, &local_0_start, &local_n1, &local_1_start);
+		vector<cx_vec> buffers(n_rhs, cx_vec(std::max<ptrdiff_t>(alloc_local, 1)));
+		fftw_complex* data = reinterpret_cast<fftw_complex*>(buffers.front().memptr());
+		const fftw_plan forward = fftw_mpi_plan_dft_3d(Nz, Ny, Nx, data, data, MPI_COMM_WORLD, FFTW_FORWARD, FFTW_ESTIMATE | FFTW_MPI_TRANSPOSED_OUT);
+		const fftw_plan backward = fftw_mpi_plan_dft_3d(Nz, Ny, Nx, data, data, MPI_COMM_WORLD, FFTW_BACKWARD, FFTW_ESTIMATE | FFTW_MPI_TRANSPOSED_IN);
+
+		// the z planes of the cubes are the units of the data distribution
+		MPI_Datatype plane;
+		MPI_Type_contiguous(Nx * Ny, MPI_CXX_DOUBLE_COMPLEX, &plane);
+		MPI_Type_commit(&plane);
+		const int local_slab[2] = { static_cast<int>(local_n0), static_cast<int>(local_0_start) };
+		vector<int> slabs(root ? 2 * mpi_ranks() : 0), slab_planes, slab_starts;
+		MPI_Gather(local_slab, 2, MPI_INT, slabs.data(), 2, MPI_INT, 0, MPI_COMM_WORLD);
+		for (size_t i = 0; i < slabs.size(); i += 2) {
+			slab_planes.push_back(slabs.at(i));
+			slab_starts.push_back(slabs.at(i + 1));
+		}
+
+		// 4PI is for the atomic units
+		for (uword r = 0; r < n_rhs; ++r) {
+			MPI_Scatterv(root ? rho.at(r).memptr() : nullptr, slab_planes.data(), slab_starts.data(), plane,
+				buffers[r].memptr(), local_n0, plane, 0, MPI_COMM_WORLD);
+			buffers[r] *= 4.0 * PI;
+			fftw_complex* buffer = reinterpret_cast<fftw_complex*>(buffers[r].memptr());
+			fftw_mpi_execute_dft(forward, buffer, buffer);
+		}
+
+		const rowvec Gs = 2.0 * PI / lengths;
+		const rowvec Gx0 = ifftshift(rowvec(ceil(regspace<rowvec>(-0.5 * Nx, 0.5 * Nx - 1)) * Gs(0)));
+		const rowvec Gy0 = ifftshift(rowvec(ceil(regspace<rowvec>(-0.5 * Ny, 0.5 * Ny - 1)) * Gs(1)));
+		const rowvec Gz0 = ifftshift(rowvec(ceil(regspace<rowvec>(-0.5 * Nz, 0.5 * Nz - 1)) * Gs(2)));
+		const cx_mat dielsG = fft(diel);
+		const cx_mat eps11 = circ_toeplitz(dielsG.col(0)) / Nz;
+		const cx_mat eps22 = circ_toeplitz(dielsG.col(1)) / Nz;
+		const cx_mat eps33 = circ_toeplitz(dielsG.col(2)) / Nz;
+		const cx_mat Az = eps33 % (Gz0.t() * Gz0);
+
+		{
+			const scoped_timer solve_timer("dense solves");
+			const uword n_Gy = local_n1;
+#pragma omp parallel
+			{
+				const trace_scope trace("distributed_poisson_solve: dense solves (OpenMP)");
+				cx_mat AG, rhs(Nz, n_rhs), solution;
+#pragma omp for collapse(2) schedule(dynamic)
+				for (uword m = 0; m < n_Gy; ++m) {
+					for (uword k = 0; k < Nx; ++k) {
+						const uword m_global = local_1_start + m;
+						for (uword r = 0; r < n_rhs; ++r) {
+							for (uword l = 0; l < Nz; ++l) {
+								rhs(l, r) = buffers[r](k + Nx * (l + Nz * m));
+							}
+						}
+						AG = Az + eps11 * square(Gx0(k)) + eps22 * square(Gy0(m_global));
+						// AG is Hermitian positive definite (the G=0 row and column are decoupled by the AG(0, 0) = 1)
+						if ((k == 0) && (m_global == 0)) { AG(0, 0) = 1; }
+						solve_hpd(solution, AG, rhs);
+						for (uword r = 0; r < n_rhs; ++r) {
+							for (uword l = 0; l < Nz; ++l) {
+								buffers[r](k + Nx * (l + Nz * m)) = solution(l, r);
+							}
+						}
+					}
+				}
+			}
+		}
+
+		vector<cx_cube> V(root ? n_rhs : 0);
+		for (uword r = 0; r < n_rhs; ++r) {
+			// 0,0,0 in k-space corresponds to a constant in the real space: average potential over the supercell.
+			if ((local_1_start == 0) && (local_n1 > 0)) {
+				buffers[r](0) = 0;
+			}
+			fftw_complex* buffer = reinterpret_cast<fftw_complex*>(buffers[r].memptr());
+			fftw_mpi_execute_dft(backward, buffer, buffer);
+			buffers[r] /= static_cast<double>(Nx * Ny * Nz);
+			if (root) {
+				V[r].set_size(Nx, Ny, Nz);
+			}
+			MPI_Gatherv(buffers[r].memptr(), local_n0, plane, root ? V[r].memptr() : nullptr,
+				slab_planes.data(), slab_starts.data(), plane, 0, MPI_COMM_WORLD);
+		}
+
+		MPI_Type_free(&plane);
+		fftw_destroy_plan(forward);
+		fftw_destroy_plan(backward);
+		return V;
+	}
+}
+
+bool mpi_initialize(int& argc, char**& argv) {
+	// only the main thread calls the MPI functions
+	int provided = 0;
+	MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
+	fftw_mpi_init();
+	MPI_Comm_rank(MPI_COMM_WORLD, &mpi_rank);
+	mpi_active = true;
+	return mpi_rank == 0;
+}
+
+void mpi_finalize() {
+	if (!mpi_active) { return; }
+	mpi_active = false;
+	if (mpi_rank == 0) {
+		int command = static_cast<int>(mpi_command::stop);
+		MPI_Bcast(&command, 1, MPI_INT, 0, MPI_COMM_WORLD);
+	}
+	fftw_mpi_cleanup();
+	MPI_Finalize();
+}
+
+int mpi_ranks() {
+	int ranks = 1;
+	if (mpi_active) {
+		MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+	}
+	return ranks;
+}
+
+void poisson_mpi_worker() {
+	while (true) {
+		int command = static_cast<int>(mpi_command::stop);
+		MPI_Bcast(&command, 1, MPI_INT, 0, MPI_COMM_WORLD);
+		if (command != static_cast<int>(mpi_command::poisson_solve)) { break; }
+		distributed_poisson_solve(vector<cx_cube>(), mat(), rowvec3());
+	}
+}
+
+vector<cx_cube> poisson_solver_mpi(const vector<cx_cube>& rho, const mat& diel, const rowvec3& lengths, const uword& normal_direction) {
+	int command = static_cast<int>(mpi_command::poisson_solve);
+	MPI_Bcast(&command, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+	// the tubes of the distributed solver are along the z direction
+	vector<cx_cube> swapped_rho;
+	for (const auto& density : rho) {
+		swapped_rho.push_back(swap_normal_axis(density, normal_direction));
+	}
+	mat swapped_diel = diel;
+	rowvec3 swapped_lengths = lengths;
+	if (normal_direction != 2) {
+		swapped_diel.swap_cols(normal_direction, 2);
+		swapped_lengths.swap_cols(normal_direction, 2);
+	}
+
+	vector<cx_cube> V = distributed_poisson_solve(swapped_rho, swapped_diel, swapped_lengths);
+	for (auto& potential : V) {
+		potential = swap_normal_axis(potential, normal_direction);
+	}
+	return V;
+}
+
+#endif
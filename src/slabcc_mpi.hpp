@@ -0,0 +1,34 @@
+// Copyright (c) 2018-2019, University of Bremen, M. Farzalipour Tabriz
+// Copyrights licensed under the 2-Clause BSD License.
+// See the accompanying LICENSE.txt file for terms.
+
+#pragma once
+#ifdef SLABCC_MPI
+#include <mpi.h>
+#include <fftw3-mpi.h>
+#include "slabcc_math.hpp"
+
+// Distributed Poisson solver for the MPI build of the slabcc (make mpi):
+// The first rank runs the slabcc as usual. The other ranks only wait for the Poisson solves and take part in them.
+// The 3D FFTs are done by the FFTW-MPI and the (Gx, Gy) tubes along the normal direction are distributed
+// over the ranks (slabs of the Gy). Each rank solves its tubes with the dense Cholesky solver using its OpenMP threads.
+
+// starts the MPI and the FFTW-MPI
+// returns true on the first rank
+bool mpi_initialize(int& argc, char**& argv);
+
+// releases the worker ranks (on the first rank) and finalizes the MPI
+// it is registered with atexit on the first rank and does nothing if it is called again
+void mpi_finalize();
+
+// number of the MPI ranks
+int mpi_ranks();
+
+// takes part in the distributed Poisson solves until the first rank calls the mpi_finalize
+void poisson_mpi_worker();
+
+// solves the Poisson equation for the charge densities on all the ranks (must be called on the first rank)
+// inputs are the same as the poisson_solver_3D
+vector<cx_cube> poisson_solver_mpi(const vector<cx_cube>& rho, const mat& diel, const rowvec3& lengths, const uword& normal_direction);
+
+#endif
@@ -0,0 +1,688 @@
+// Copyright (c) 2018-2019, University of Bremen, M. Farzalipour Tabriz
+// Copyrights licensed under the 2-Clause BSD License.
+// See the accompanying LICENSE.txt file for terms.
+
+#include "slabcc_serve.hpp"
+#include <list>
+#include <deque>
+#include <cmath>
+#include <cerrno>
+#include <cstring>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <csignal>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	// section of the job parameters after the shared parameters
+	const string job_section = "slabcc serve job";
+
+	// a JSON value of a job (numbers are kept as they are written)
+	struct json_value {
+		enum class type :int {
+			null, boolean, number, text, array, object
+		};
+		type kind = type::null;
+		string text;	// string, number, or the "yes"/"no" of the booleans
+		vector<json_value> elements;
+		vector<pair<string, json_value>> members;
+	};
+
+	// parser of a JSON document in a single line
+	// throws runtime_error on the syntax errors
+	class json_parser {
+	public:
+		explicit json_parser(const string& document) : document(document) {}
+
+		json_value parse() {
+			json_value value = parse_value();
+			skip_spaces();
+			if (position != document.size()) { fail("unexpected characters after the end of the value"); }
+			return value;
+		}
+
+	private:
+		const string& document;
+		size_t position = 0;
+
+		[[noreturn]] void fail(const string& message) const {
+			throw runtime_error("Invalid JSON (column " + to_string(position + 1) + "): " + message);
+		}
+
+		void skip_spaces() noexcept {
+			while ((position < document.size()) && isspace(static_cast<unsigned char>(document[position]))) { ++position; }
+		}
+
+		bool next_is(const char& c) {
+			skip_spaces();
+			if ((position < document.size()) && (document[position] == c)) {
+				++position;
+				return true;
+			}
+			return false;
+		}
+
+		void expect(const char& c) {
+			if (!next_is(c)) { fail(string("'") + c + "' is expected"); }
+		}
+
+		bool next_is_word(const string& word) {
+			if (document.compare(position, word.size(), word) != 0) { return false; }
+			position += word.size();
+			return true;
+		}
+
+		json_value parse_value() {
+			skip_spaces();
+			if (position == document.size()) { fail("a value is expected"); }
+			json_value value;
+			const char c = document[position];
+			if (c == '{') {
+				++position;
+				value.kind = json_value::type::object;
+				if (next_is('}')) { return value; }
+				do {
+					skip_spaces();
+					if ((position == document.size()) || (document[position] != '"')) { fail("a name is expected"); }
+					const string name = parse_string();
+					expect(':');
+					value.members.emplace_back(name, parse_value());
+				} while (next_is(','));
+				expect('}');
+			}
+			else if (c == '[') {
+				++position;
+				value.kind = json_value::type::array;
+				if (next_is(']')) { return value; }
+				do {
+					value.elements.push_back(parse_value());
+				} while (next_is(','));
+				expect(']');
+			}
+			else if (c == '"') {
+				value.kind = json_value::type::text;
+				value.text = parse_string();
+			}
+			else if (next_is_word("true")) {
+				value.kind = json_value::type::boolean;
+				value.text = "yes";
+			}
+			else if (next_is_word("false")) {
+				value.kind = json_value::type::boolean;
+				value.text = "no";
+			}
+			else if (next_is_word("null")) {
+				value.kind = json_value::type::null;
+			}
+			else {
+				value.kind = json_value::type::number;
+				value.text = parse_number();
+			}
+			return value;
+		}
+
+		string parse_string() {
+			++position;
+			string text;
+			while (true) {
+				if (position == document.size()) { fail("unterminated string"); }
+				const char c = document[position++];
+				if (c == '"') { return text; }
+				if (static_cast<unsigned char>(c) < 0x20) { fail("control character in the string"); }
+				if (c != '\\') {
+					text += c;
+					continue;
+				}
+				if (position == document.size()) { fail("unterminated string"); }
+				const char escaped = document[position++];
+				switch (escaped) {
+				case '"': text += '"'; break;
+				case '\\': text += '\\'; break;
+				case '/': text += '/'; break;
+				case 'b': text += '\b'; break;
+				case 'f': text += '\f'; break;
+				case 'n': text += '\n'; break;
+				case 'r': text += '\r'; break;
+				case 't': text += '\t'; break;
+				case 'u': {
+					if ((position + 4 > document.size()) || !all_of(document.begin() + position, document.begin() + position + 4, [](const char& h) { return isxdigit(static_cast<unsigned char>(h)) != 0; })) {
+						fail("invalid unicode escape");
+					}
+					const unsigned long code = stoul(document.substr(position, 4), nullptr, 16);
+					position += 4;
+					// UTF-8 encoding of the basic multilingual plane
+					if (code < 0x80) {
+						text += static_cast<char>(code);
+					}
+					else if (code < 0x800) {
+						text += static_cast<char>(0xC0 | (code >> 6));
+						text += static_cast<char>(0x80 | (code & 0x3F));
+					}
+					else {
+						text += static_cast<char>(0xE0 | (code >> 12));
+						text += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+						text += static_cast<char>(0x80 | (code & 0x3F));
+					}
+					break;
+				}
+				default: fail("invalid escape character");
+				}
+			}
+		}
+
+		string parse_number() {
+			const size_t start = position;
+			const auto digits = [this]() {
+				const size_t first = position;
+				while ((position < document.size()) && isdigit(static_cast<unsigned char>(document[position]))) { ++position; }
+				return position > first;
+			};
+			if ((position < document.size()) && (document[position] == '-')) { ++position; }
+			if (!digits()) { fail("invalid value"); }
+			if ((position < document.size()) && (document[position] == '.')) {
+				++position;
+				if (!digits()) { fail("invalid number"); }
+			}
+			if ((position < document.size()) && ((document[position] == 'e') || (document[position] == 'E'))) {
+				++position;
+				if ((position < document.size()) && ((document[position] == '+') || (document[position] == '-'))) { ++position; }
+				if (!digits()) { fail("invalid number"); }
+			}
+			return document.substr(start, position - start);
+		}
+	};
+
+	// value of a job parameter in the syntax of the input file:
+	// arrays are written as the space separated values and the arrays of arrays as the rows of a matrix
+	string input_value(const string& name, const json_value& value) {
+		const auto scalar = [&name](const json_value& element) {
+			if ((element.kind != json_value::type::number) && (element.kind != json_value::type::boolean) && (element.kind != json_value::type::text)) {
+				throw runtime_error("Unsupported value of the parameter: " + name);
+			}
+			// the line breaks and the comments of the input files cannot be used in the values
+			if (element.text.find_first_of("\r\n#") != string::npos) {
+				throw runtime_error("Unsupported characters in the value of the parameter: " + name);
+			}
+			return element.text;
+		};
+		const auto row = [&scalar](const json_value& array) {
+			string values;
+			for (const auto& element : array.elements) {
+				values += (values.empty() ? "" : " ") + scalar(element);
+			}
+			return values;
+		};
+
+		if (value.kind != json_value::type::array) {
+			return scalar(value);
+		}
+		if (!value.elements.empty() && (value.elements.front().kind == json_value::type::array)) {
+			string rows;
+			for (const auto& element : value.elements) {
+				if (element.kind != json_value::type::array) {
+					throw runtime_error("Mixed rows and values in the parameter: " + name);
+				}
+				rows += row(element) + "; ";
+			}
+			return rows;
+		}
+		return row(value);
+	}
+
+	string json_string(const string& text) {
+		ostringstream json;
+		json << '"';
+		for (const char& c : text) {
+			switch (c) {
+			case '"': json << "\\\""; break;
+			case '\\': json << "\\\\"; break;
+			case '\n': json << "\\n"; break;
+			case '\r': json << "\\r"; break;
+			case '\t': json << "\\t"; break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20) {
+					json << "\\u" << hex << setw(4) << setfill('0') << static_cast<int>(c) << dec;
+				}
+				else {
+					json << c;
+				}
+			}
+		}
+		json << '"';
+		return json.str();
+	}
+
+	string json_number(const double& number) {
+		if (!std::isfinite(number)) { return "null"; }
+		ostringstream json;
+		json << setprecision(15) << number;
+		return json.str();
+	}
+
+	// job ids are used in the names of the written files
+	string file_name_id(const string& id) {
+		string name = id;
+		for (auto& c : name) {
+			if (!isalnum(static_cast<unsigned char>(c)) && (c != '-') && (c != '.')) { c = '_'; }
+		}
+		return name;
+	}
+
+	// modification time and size of a file (empty if the file does not exist)
+	string file_stamp(const string& file_name) {
+		struct stat file_status;
+		if (stat(file_name.c_str(), &file_status) != 0) { return ""; }
+		return to_string(static_cast<long long>(file_status.st_mtime)) + ":" + to_string(static_cast<long long>(file_status.st_size));
+	}
+
+	// least recently used cache of the supercells and the resampled target potentials of the serve mode
+	class serve_cache {
+	public:
+		// the supercell of the files from the cache or from the files
+		// reused: the supercell has been found in the cache
+		slabcc_status supercell_of(const string& CHGCAR_file, const string& LOCPOT_file, shared_ptr<const supercell>& cell, bool& reused) {
+			const string key = "supercell\n" + CHGCAR_file + "\n" + LOCPOT_file;
+			const string stamp = file_stamp(CHGCAR_file) + ";" + file_stamp(LOCPOT_file);
+			auto entry = find(key, stamp);
+			reused = (entry != entries.end());
+			if (reused) {
+				cell = entry->cell;
+				return {};
+			}
+
+			auto new_cell = make_shared<supercell>();
+			const slabcc_status status = read_supercell(CHGCAR_file, LOCPOT_file, *new_cell);
+			if (status) {
+				cell = new_cell;
+				entries.push_front(cache_entry{ key, stamp, cell, nullptr });
+			}
+			return status;
+		}
+
+		// the resampled target potentials of the defect (neutral and charged supercells)
+		// reused: there have been resampled potentials in the cache
+		shared_ptr<resampled_potentials> potentials_of(const slabcc_parameters& parameters, bool& reused) {
+			const string key = "potentials\n" + parameters.CHGCAR_neutral + "\n" + parameters.LOCPOT_neutral + "\n" + parameters.CHGCAR_charged + "\n" + parameters.LOCPOT_charged;
+			const string stamp = file_stamp(parameters.CHGCAR_neutral) + ";" + file_stamp(parameters.LOCPOT_neutral) + ";"
+				+ file_stamp(parameters.CHGCAR_charged) + ";" + file_stamp(parameters.LOCPOT_charged);
+			auto entry = find(key, stamp);
+			reused = (entry != entries.end()) && (entry->potentials->memory() > 0);
+			if (entry != entries.end()) {
+				return entry->potentials;
+			}
+			entries.push_front(cache_entry{ key, stamp, nullptr, make_shared<resampled_potentials>() });
+			return entries.front().potentials;
+		}
+
+		// removes the least recently used entries until the cache fits in the memory (GB)
+		void trim(const double& memory) {
+			auto log = spdlog::get("loggers");
+			double used_memory = 0;
+			for (const auto& entry : entries) {
+				used_memory += entry.memory();
+			}
+			while (!entries.empty() && (used_memory > memory * 1e9)) {
+				used_memory -= entries.back().memory();
+				log->debug("Removed from the cache: {}", entries.back().key);
+				entries.pop_back();
+			}
+			log->debug("Cached supercells and potentials: {}, memory: {} GB", entries.size(), used_memory / 1e9);
+		}
+
+	private:
+		struct cache_entry {
+			string key, stamp;
+			shared_ptr<const supercell> cell;
+			shared_ptr<resampled_potentials> potentials;
+
+			double memory() const {
+				double bytes = 0;
+				if (cell) {
+					bytes += sizeof(double) * static_cast<double>(cell->charge.n_elem + cell->potential.n_elem);
+				}
+				if (potentials) {
+					bytes += potentials->memory();
+				}
+				return bytes;
+			}
+		};
+		list<cache_entry> entries;
+
+		// finds the entry and moves it to the front of the list
+		// the entries of the modified files are removed
+		list<cache_entry>::iterator find(const string& key, const string& stamp) {
+			auto entry = find_if(entries.begin(), entries.end(), [&key](const cache_entry& e) { return e.key == key; });
+			if (entry == entries.end()) { return entry; }
+			if (entry->stamp != stamp) {
+				spdlog::get("loggers")->debug("Modified files have been removed from the cache: {}", entry->key);
+				entries.erase(entry);
+				return entries.end();
+			}
+			entries.splice(entries.begin(), entries, entry);
+			return entries.begin();
+		}
+	};
+
+	class job_server {
+	public:
+		job_server(const string& shared_parameters, const bool& output_diffs_only) :
+			shared_parameters(shared_parameters), output_diffs_only(output_diffs_only) {}
+
+		bool all_succeeded = true;
+
+		// runs the job (or the command) of a line and returns its JSON response
+		// stop: shutdown command has been received
+		string run(const string& line, bool& stop) {
+			auto log = spdlog::get("loggers");
+			++job_number;
+			json_value job;
+			try {
+				job = json_parser(line).parse();
+				if (job.kind != json_value::type::object) {
+					throw runtime_error("Jobs must be JSON objects!");
+				}
+			}
+			catch (const exception& error) {
+				log->error(error.what());
+				all_succeeded = false;
+				return "{\"success\": false, \"error\": " + json_string(error.what()) + "}";
+			}
+
+			for (const auto& member : job.members) {
+				if (member.first != "command") { continue; }
+				if (member.second.text == "shutdown") {
+					stop = true;
+					log->info("Shutdown of the server has been requested.");
+					return "{\"command\": \"shutdown\", \"success\": true}";
+				}
+				log->error("Unknown command: {}", member.second.text);
+				all_succeeded = false;
+				return "{\"command\": " + json_string(member.second.text) + ", \"success\": false, \"error\": \"Unknown command!\"}";
+			}
+			return run_job(job);
+		}
+
+	private:
+		const string& shared_parameters;
+		const bool output_diffs_only;
+		serve_cache cache;
+		size_t job_number = 0;
+
+		string run_job(const json_value& job) {
+			auto log = spdlog::get("loggers");
+			auto output_log = spdlog::get("output");
+			const auto start_time = chrono::steady_clock::now();
+			string id = "job" + to_string(job_number);
+			string job_parameters = "";
+			slabcc_parameters parameters;
+			parameters.output_diffs_only = output_diffs_only;
+			slabcc_result result;
+			bool neutral_reused = false, charged_reused = false, potentials_reused = false;
+
+			vector<string> messages;
+			redirect_messages(&messages);
+			try {
+				for (const auto& member : job.members) {
+					if (member.first == "id") {
+						if (!member.second.text.empty()) { id = member.second.text; }
+						continue;
+					}
+					if (member.first.empty() || (member.first.find_first_not_of("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_") != string::npos)) {
+						throw runtime_error("Invalid parameter name: " + member.first);
+					}
+					if (member.second.kind == json_value::type::null) { continue; }
+					job_parameters += member.first + " = " + input_value(member.first, member.second) + "\n";
+				}
+				log->info("Serve job: {}", id);
+				parameters.output_id = file_name_id(id) + "_";
+
+				const input_data job_variables = parameters.input_variables();
+				job_variables.parse_string(shared_parameters + "\n[" + job_section + "]\n" + job_parameters, job_section);
+				if (!output_diffs_only) {
+					job_variables.verify();
+				}
+
+				shared_ptr<const supercell> neutral, charged;
+				result.status = cache.supercell_of(parameters.CHGCAR_neutral, parameters.LOCPOT_neutral, neutral, neutral_reused);
+				if (result.status) {
+					result.status = cache.supercell_of(parameters.CHGCAR_charged, parameters.LOCPOT_charged, charged, charged_reused);
+				}
+				if (result.status) {
+					const auto potentials = output_diffs_only ? nullptr : cache.potentials_of(parameters, potentials_reused);
+					result = calculate_correction(*neutral, *charged, parameters, potentials);
+				}
+				cache.trim(parameters.cache_memory);
+			}
+			catch (const slabcc_error& error) {
+				result.status.success = false;
+				result.status.error = error.what();
+			}
+			catch (const exception& error) {
+				log->critical(error.what());
+				result.status.success = false;
+				result.status.error = error.what();
+			}
+			redirect_messages(nullptr);
+			all_succeeded = all_succeeded && result.status;
+			const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+			log->info("Serve job {} finished in {} s: {}", id, seconds, result.status ? "success" : "failed");
+
+			output_log->info("\n[Job: {}]", id);
+			output_log->info("status = {}", result.status ? "success" : "failed");
+			if (!result.status) {
+				output_log->info("error = {}", result.status.error);
+			}
+			for (const auto &j : result.optimized_parameters) { output_log->info("{} = {}", j.first, j.second); }
+			for (const auto &j : result.results) { output_log->info("{} = {}", j.first, j.second); }
+			for (const auto &message : messages) { output_log->info(message); }
+			output_log->flush();
+
+			ostringstream response;
+			response << "{\"id\": " << json_string(id) << ", \"success\": " << (result.status ? "true" : "false");
+			if (!result.status) {
+				response << ", \"error\": " << json_string(result.status.error);
+			}
+			else if (!output_diffs_only) {
+				response << ", \"dV\": " << json_number(result.dV) << ", \"E_periodic\": " << json_number(result.E_periodic)
+					<< ", \"E_isolated\": " << json_number(result.E_isolated) << ", \"E_correction\": " << json_number(result.E_correction)
+					<< ", \"potential_RMSE\": " << json_number(result.potential_RMSE);
+			}
+			response << ", \"optimized_parameters\": {";
+			for (size_t i = 0; i < result.optimized_parameters.size(); ++i) {
+				response << (i ? ", " : "") << json_string(result.optimized_parameters.at(i).first) << ": " << json_string(result.optimized_parameters.at(i).second);
+			}
+			response << "}, \"messages\": [";
+			for (size_t i = 0; i < messages.size(); ++i) {
+				response << (i ? ", " : "") << json_string(messages.at(i));
+			}
+			response << "], \"cache\": {\"neutral\": " << (neutral_reused ? "true" : "false") << ", \"charged\": " << (charged_reused ? "true" : "false")
+				<< ", \"resampled_potentials\": " << (potentials_reused ? "true" : "false") << "}, \"time\": " << json_number(seconds) << "}";
+			return response.str();
+		}
+	};
+
+	bool serve_stdin(job_server& server) {
+		string line;
+		bool stop = false;
+		while (!stop && getline(cin, line)) {
+			if (line.find_first_not_of(" \t\r") == string::npos) { continue; }
+			cout << server.run(line, stop) << endl;
+		}
+		return server.all_succeeded;
+	}
+
+#ifndef _WIN32
+	// sends the whole response to the client
+	bool send_line(const int& socket_fd, const string& line) {
+		const string data = line + "\n";
+		size_t sent = 0;
+		while (sent < data.size()) {
+			const ssize_t n = send(socket_fd, data.data() + sent, data.size() - sent, 0);
+			if (n < 0) {
+				if (errno == EINTR) { continue; }
+				return false;
+			}
+			sent += static_cast<size_t>(n);
+		}
+		return true;
+	}
+
+	bool serve_socket(job_server& server, const string& socket_path) {
+		auto log = spdlog::get("loggers");
+		sockaddr_un address;
+		memset(&address, 0, sizeof(address));
+		address.sun_family = AF_UNIX;
+		if (socket_path.size() >= sizeof(address.sun_path)) {
+			log->critical("The path of the socket is too long: {}", socket_path);
+			return false;
+		}
+		strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+
+		// only the old sockets are replaced
+		struct stat file_status;
+		if (lstat(socket_path.c_str(), &file_status) == 0) {
+			if (!S_ISSOCK(file_status.st_mode)) {
+				log->critical("The path of the socket already exists: {}", socket_path);
+				return false;
+			}
+			unlink(socket_path.c_str());
+		}
+
+		const int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if ((listen_fd < 0) || (bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) || (listen(listen_fd, SOMAXCONN) != 0)) {
+			log->critical("Cannot listen on the socket {}: {}", socket_path, strerror(errno));
+			if (listen_fd >= 0) { close(listen_fd); }
+			return false;
+		}
+		// the responses to the disconnected clients are dropped
+		signal(SIGPIPE, SIG_IGN);
+		log->info("Waiting for the jobs on the socket: {}", socket_path);
+
+		struct client {
+			size_t id;
+			int fd;
+			string received;
+		};
+		vector<client> clients;
+		size_t client_number = 0;
+		// jobs in the order of their arrival: client id and the job line
+		deque<pair<size_t, string>> queue;
+
+		bool stop = false;
+		while (!stop) {
+			vector<pollfd> polled(1, pollfd{ listen_fd, POLLIN, 0 });
+			for (const auto& c : clients) {
+				polled.push_back(pollfd{ c.fd, POLLIN, 0 });
+			}
+			// the queued jobs are not delayed by the polling
+			if (poll(polled.data(), polled.size(), queue.empty() ? -1 : 0) < 0) {
+				if (errno == EINTR) { continue; }
+				log->critical("Polling the socket failed: {}", strerror(errno));
+				break;
+			}
+
+			vector<size_t> closed;
+			for (size_t i = 0; i < clients.size(); ++i) {
+				if (polled.at(i + 1).revents == 0) { continue; }
+				char buffer[4096];
+				const ssize_t n = recv(clients.at(i).fd, buffer, sizeof(buffer), 0);
+				if (n <= 0) {
+					closed.push_back(clients.at(i).id);
+					continue;
+				}
+				auto& received = clients.at(i).received;
+				received.append(buffer, static_cast<size_t>(n));
+				size_t line_end = received.find('\n');
+				while (line_end != string::npos) {
+					const string line = received.substr(0, line_end);
+					received.erase(0, line_end + 1);
+					if (line.find_first_not_of(" \t\r") != string::npos) {
+						queue.emplace_back(clients.at(i).id, line);
+					}
+					line_end = received.find('\n');
+				}
+			}
+			for (const auto& id : closed) {
+				const auto c = find_if(clients.begin(), clients.end(), [&id](const client& cl) { return cl.id == id; });
+				close(c->fd);
+				clients.erase(c);
+			}
+
+			if (polled.front().revents & POLLIN) {
+				const int client_fd = accept(listen_fd, nullptr, nullptr);
+				if (client_fd >= 0) {
+					clients.push_back(client{ client_number++, client_fd, "" });
+				}
+			}
+
+			if (!queue.empty()) {
+				const auto job = queue.front();
+				queue.pop_front();
+				const string response = server.run(job.second, stop);
+				const auto c = find_if(clients.begin(), clients.end(), [&job](const client& cl) { return cl.id == job.first; });
+				if ((c != clients.end()) && !send_line(c->fd, response)) {
+					log->debug("The response of the job could not be sent: {}", response);
+				}
+			}
+		}
+
+		if (!queue.empty()) {
+			log->warn("{} received jobs have been dropped after the shutdown of the server!", queue.size());
+		}
+		for (const auto& c : clients) { close(c.fd); }
+		close(listen_fd);
+		unlink(socket_path.c_str());
+		return server.all_succeeded;
+	}
+#endif
+}
+
+slabcc_status read_serve_parameters(const string& input_file, string& shared_parameters) {
+	auto log = spdlog::get("loggers");
+	slabcc_status status;
+	shared_parameters.clear();
+	try {
+		if (file_exists(input_file)) {
+			ifstream file(input_file);
+			ostringstream contents;
+			contents << file.rdbuf();
+			shared_parameters = contents.str();
+		}
+		slabcc_parameters parameters;
+		parameters.input_variables().parse_string(shared_parameters);
+		if (shared_parameters.empty()) {
+			log->debug("Input file could not be found: {}. Only the parameters of the jobs and the default values will be used!", input_file);
+		}
+		if (!INIReader::from_string(shared_parameters).Sections().empty()) {
+			log->warn("The parameters in the sections of the input file are only used in the batch mode (--batch)!");
+		}
+	}
+	catch (const slabcc_error& error) {
+		status.success = false;
+		status.error = error.what();
+	}
+	catch (const exception& error) {
+		log->critical(error.what());
+		status.success = false;
+		status.error = error.what();
+	}
+	return status;
+}
+
+bool serve_jobs(const string& endpoint, const string& shared_parameters, const bool& output_diffs_only) {
+	const scoped_timer timer("serve_jobs");
+	job_server server(shared_parameters, output_diffs_only);
+	if (endpoint == "stdin") {
+		return serve_stdin(server);
+	}
+#ifndef _WIN32
+	return serve_socket(server, endpoint);
+#else
+	spdlog::get("loggers")->critical("The Unix domain sockets are not supported on this platform. Use \"--serve stdin\" to receive the jobs on the stdin!");
+	return false;
+#endif
+}
@@ -0,0 +1,31 @@
+// Copyright (c) 2018-2019, University of Bremen, M. Farzalipour Tabriz
+// Copyrights licensed under the 2-Clause BSD License.
+// See the accompanying LICENSE.txt file for terms.
+
+#pragma once
+#include "slabcc_api.hpp"
+
+// Resident server mode of the slabcc (slabcc --serve):
+// The jobs are received as JSON objects, one per line, on a Unix domain socket or on the stdin (--serve stdin).
+// The keys of a job are the parameters of the slabcc input file and an optional "id" of the job, e.g.
+// {"id": "V_O", "CHGCAR_charged": "V_O/CHGCAR", "LOCPOT_charged": "V_O/LOCPOT", "charge_position": [[0.5, 0.5, 0.37]], "diel_in": 8.5}
+// Numbers, strings, booleans, arrays (space separated values), and arrays of arrays (matrix rows) are accepted.
+// The parameters of the input file are used for the missing parameters of the jobs.
+// The jobs are queued in the order of their arrival and calculated one at a time with all the threads.
+// The result of each job is sent back as a JSON object in one line (on the socket or the stdout)
+// and is also written to a [Job: id] section of the output file.
+// {"command": "shutdown"} stops the server after the jobs which have been received before it.
+//
+// The supercells (CHGCAR and LOCPOT pairs) and the target potentials of the defects resampled on the model grids are kept
+// between the jobs in a least recently used cache as long as they fit in the cache_memory of the last job.
+// A file is read again if its modification time or its size has been changed.
+// The loggers must be initialized before (initialize_loggers).
+
+// reads the input file which has the shared parameters of all the jobs and writes them to the output file
+// shared_parameters: contents of the input file (empty if the input file does not exist)
+slabcc_status read_serve_parameters(const string& input_file, string& shared_parameters);
+
+// runs the server until the shutdown command or the end of the stdin
+// endpoint: path of the Unix domain socket or "stdin" for the stdin and the stdout
+// returns false if the server could not be started or any of the jobs have failed
+bool serve_jobs(const string& endpoint, const string& shared_parameters, const bool& output_diffs_only = false);
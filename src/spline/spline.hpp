@@ -10,6 +10,8 @@ The code has been converted to use Armadillo data type for slabcc by https://git
 */
 #include <vector>
 #include <iostream>
+#include <algorithm>
+#include <cmath>
 #include <armadillo>
 
 
@@ -53,12 +55,24 @@ public:
 		for (arma::uword i = 0; i < n; ++i) {
 			mElements.push_back(Element(x(i), y(i), b(i), c(i), d(i)));
 		}
+
+		// uniform grids: the segment of each point is found directly from its position
+		mUniform = arma::max(arma::abs(h.head(n) - h(0))) <= 1e-10 * std::abs(h(0));
+		mX0 = x(0);
+		mH = h(0);
 	}
 
 	//return the value of the spline function for x
 	X interpolate(const X&x) const {
 		if (mElements.empty()) return X();
 
+		if (mUniform) {
+			// same segment as the binary search: the last element with (element.x < x) or the first element
+			const X segment = std::ceil((x - mX0) / mH) - 1;
+			const arma::uword i = (segment > 0) ? std::min(static_cast<arma::uword>(segment), static_cast<arma::uword>(mElements.size() - 1)) : 0;
+			return mElements[i].eval(x);
+		}
+
 		auto it = std::lower_bound(mElements.begin(), mElements.end(), element_type(x));
 		if (it != mElements.begin()) { --it; }
 		return it->eval(x);
@@ -98,5 +112,7 @@ protected:
 	};
 	typedef Element element_type;
 	std::vector<element_type> mElements;
+	bool mUniform = false;	// equally spaced x values
+	X mX0 = 0, mH = 0;		// first x value and the spacing of the uniform grids
 
 };
@@ -0,0 +1,158 @@
+// Copyright (c) 2018-2019, University of Bremen, M. Farzalipour Tabriz
+// Copyrights licensed under the 2-Clause BSD License.
+// See the accompanying LICENSE.txt file for terms.
+
+#include "timing.hpp"
+
+namespace {
+	const auto program_start = chrono::steady_clock::now();
+	mutex timing_mutex;
+	timing_node timing_root{ "slabcc" };
+	thread_local timing_node* current_node = &timing_root;
+
+	struct trace_event {
+		string name;
+		char phase;
+		double timestamp;	// (us)
+		int thread;
+	};
+	atomic<bool> tracing_enabled{ false };
+	atomic<int> threads_counter{ 0 };
+	thread_local const int thread_id = threads_counter++;
+	mutex trace_mutex;
+	vector<trace_event> trace_events;
+
+	double seconds_since(const chrono::steady_clock::time_point& start) {
+		return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	}
+
+	void write_timing_tree(const shared_ptr<spdlog::logger>& output_log, const timing_node& node, const int& depth) {
+		const string name = string(2 * depth, ' ') + node.name;
+		output_log->info("{:<48} {:>10} {:>14.6f} {:>14.6f}", name, node.calls, node.inclusive, node.exclusive());
+		for (const auto& child : node.children) {
+			write_timing_tree(output_log, *child, depth + 1);
+		}
+	}
+
+	void write_timing_json(ostream& out, const timing_node& node, const int& depth) {
+		const string indent(depth * 2, ' ');
+		out << indent << "{\"name\": \"" << node.name << "\", \"calls\": " << node.calls
+			<< ", \"inclusive\": " << node.inclusive << ", \"exclusive\": " << node.exclusive()
+			<< ", \"children\": [";
+		if (!node.children.empty()) {
+			out << '\n';
+			for (size_t i = 0; i < node.children.size(); ++i) {
+				write_timing_json(out, *node.children.at(i), depth + 1);
+				out << (i + 1 < node.children.size() ? ",\n" : "\n");
+			}
+			out << indent;
+		}
+		out << "]}";
+	}
+}
+
+timing_node* timing_node::child(const string& child_name) {
+	for (auto& node : children) {
+		if (node->name == child_name) {
+			return node.get();
+		}
+	}
+	children.push_back(make_unique<timing_node>());
+	children.back()->name = child_name;
+	children.back()->parent = this;
+	return children.back().get();
+}
+
+double timing_node::exclusive() const {
+	double children_time = 0;
+	for (const auto& node : children) {
+		children_time += node->inclusive;
+	}
+	return max(inclusive - children_time, 0.0);
+}
+
+scoped_timer::scoped_timer(const string& name) : start(chrono::steady_clock::now()) {
+	record_trace_event(name, 'B');
+	lock_guard<mutex> lock(timing_mutex);
+	parent = current_node;
+	node = parent->child(name);
+	current_node = node;
+}
+
+scoped_timer::~scoped_timer() {
+	const double elapsed = seconds_since(start);
+	record_trace_event(node->name, 'E');
+	lock_guard<mutex> lock(timing_mutex);
+	++node->calls;
+	node->inclusive += elapsed;
+	current_node = parent;
+}
+
+void start_tracing() {
+	// the thread which starts the tracing gets the first thread id
+	static_cast<void>(thread_id);
+	tracing_enabled = true;
+	record_trace_event("slabcc", 'B');
+}
+
+void record_trace_event(const string& name, const char& phase) {
+	if (!tracing_enabled) return;
+	const double timestamp = 1e6 * seconds_since(program_start);
+	lock_guard<mutex> lock(trace_mutex);
+	trace_events.push_back({ name, phase, timestamp, thread_id });
+}
+
+trace_scope::trace_scope(string name) : name(move(name)) {
+	record_trace_event(this->name, 'B');
+}
+
+trace_scope::~trace_scope() {
+	record_trace_event(name, 'E');
+}
+
+void write_trace(const string& trace_file) {
+	auto log = spdlog::get("loggers");
+	if (!tracing_enabled) return;
+	record_trace_event("slabcc", 'E');
+	tracing_enabled = false;
+
+	ofstream out_file(trace_file);
+	if (!out_file) {
+		log->warn("Could not write the trace events to " + trace_file);
+		return;
+	}
+	lock_guard<mutex> lock(trace_mutex);
+	out_file << fixed << setprecision(3);
+	out_file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+	for (size_t i = 0; i < trace_events.size(); ++i) {
+		const auto& event = trace_events.at(i);
+		out_file << "{\"name\": \"" << event.name << "\", \"cat\": \"slabcc\", \"ph\": \"" << event.phase
+			<< "\", \"ts\": " << event.timestamp << ", \"pid\": 1, \"tid\": " << event.thread << "}";
+		out_file << (i + 1 < trace_events.size() ? ",\n" : "\n");
+	}
+	out_file << "]}\n";
+	log->trace("{} trace events are written to {}", trace_events.size(), trace_file);
+}
+
+void write_timing_report(const string& json_file) {
+	auto log = spdlog::get("loggers");
+	auto output_log = spdlog::get("output");
+	lock_guard<mutex> lock(timing_mutex);
+	timing_root.calls = 1;
+	timing_root.inclusive = seconds_since(program_start);
+
+	output_log->info("\n[Timing]");
+	output_log->info("{:<48} {:>10} {:>14} {:>14}", "# function", "calls", "inclusive(s)", "exclusive(s)");
+	write_timing_tree(output_log, timing_root, 0);
+	output_log->flush();
+
+	ofstream out_file(json_file);
+	if (!out_file) {
+		log->warn("Could not write the timing report to " + json_file);
+		return;
+	}
+	out_file << setprecision(9);
+	write_timing_json(out_file, timing_root, 0);
+	out_file << '\n';
+	log->trace("Timing report is written to " + json_file);
+}
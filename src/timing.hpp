@@ -0,0 +1,72 @@
+// Copyright (c) 2018-2019, University of Bremen, M. Farzalipour Tabriz
+// Copyrights licensed under the 2-Clause BSD License.
+// See the accompanying LICENSE.txt file for terms.
+
+#pragma once
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include "general_io.hpp"
+
+using namespace std;
+
+// Hierarchical timing of the calculation steps:
+// each scoped_timer adds its lifetime to a node of a call tree which is identified by
+// the timer name and the chain of the active timers in the same thread.
+// Timers created in the async threads are attached to the root of the tree.
+// Do not use the timers inside the OpenMP parallel regions!
+
+struct timing_node {
+	string name;
+	unsigned long long calls = 0;
+	double inclusive = 0;					// total time spent in this node and its children (s)
+	timing_node* parent = nullptr;
+	vector<unique_ptr<timing_node>> children;
+
+	// returns the child with the given name, creates it if it does not exist
+	timing_node* child(const string& child_name);
+
+	// time spent in this node minus the time spent in its children (s)
+	// children running concurrently in other threads may sum up to more than the parent's time
+	double exclusive() const;
+};
+
+// Chrome/Perfetto trace-event recording (opt-in with the --trace command-line option):
+// every scoped_timer and trace_scope adds a begin and an end event tagged with its thread id.
+// trace_scope can also be used inside the OpenMP parallel regions.
+
+// starts recording the trace events
+void start_tracing();
+
+// phase: 'B' (begin) or 'E' (end)
+void record_trace_event(const string& name, const char& phase);
+
+// writes the recorded events to the trace_file in the trace-event JSON format
+void write_trace(const string& trace_file);
+
+class trace_scope {
+public:
+	explicit trace_scope(string name);
+	~trace_scope();
+	trace_scope(const trace_scope&) = delete;
+	trace_scope& operator=(const trace_scope&) = delete;
+
+private:
+	const string name;
+};
+
+class scoped_timer {
+public:
+	explicit scoped_timer(const string& name);
+	~scoped_timer();
+	scoped_timer(const scoped_timer&) = delete;
+	scoped_timer& operator=(const scoped_timer&) = delete;
+
+private:
+	timing_node* node = nullptr;
+	timing_node* parent = nullptr;
+	const chrono::steady_clock::time_point start;
+};
+
+// writes the timing tree into the [Timing] section of the output file and as JSON into the json_file
+void write_timing_report(const string& json_file);
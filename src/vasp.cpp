@@ -5,6 +5,7 @@
 #include "vasp.hpp"
 
 void supercell::write_POSCAR(const string& file_name) const{
+	const scoped_timer timer("supercell::write_POSCAR");
 	ofstream out_file;
 	out_file.open(file_name);
 	out_file << label << '\n';
@@ -73,6 +74,7 @@ void supercell::normalize_positions() {
 }
 
 void supercell::shift(const rowvec3& relative_shift) {
+	const scoped_timer timer("supercell::shift");
 
 	rowvec3 pos_shift = relative_shift;
 
@@ -94,6 +96,7 @@ void supercell::shift(const rowvec3& relative_shift) {
 }
 
 supercell::supercell(const string& file_name) {
+	const scoped_timer timer("supercell::supercell");
 	auto log = spdlog::get("loggers");
 	ifstream infile;
 	string temp_line;
@@ -171,7 +174,15 @@ supercell::supercell(const string& file_name) {
 	normalize_positions();
 }
 
+supercell::supercell(const mat33& cell_vectors, const urowvec3& grid) :
+	label("slabcc"), cell_vectors(cell_vectors), selective_dynamics(false), coordination_system("direct") {
+	atoms.position.set_size(0, 3);
+	charge = zeros(as_size(grid));
+	potential = zeros(as_size(grid));
+}
+
 cube read_VASP_grid_data(const string& file_name) {
+	const scoped_timer timer("read_VASP_grid_data");
 	auto log = spdlog::get("loggers");
 	ifstream infile;
 	string temp_line;
@@ -202,6 +213,7 @@ cube read_VASP_grid_data(const string& file_name) {
 }
 
 void supercell::write_CHGPOT(const string& type, const string& file_name) const {
+	const scoped_timer timer("supercell::write_CHGPOT");
 	auto log = spdlog::get("loggers");
 	log->trace("Started writing " + file_name);
 
@@ -236,6 +248,7 @@ void supercell::write_LOCPOT(const string& file_name) const {
 	write_CHGPOT("LOCPOT", file_name);
 }
 void write_planar_avg(const cube& potential_data, const cube& charge_data, const string& id, const rowvec3& coordinate_vectors, const int direction) {
+	const scoped_timer timer("write_planar_avg");
 	auto log = spdlog::get("loggers");
 	unsigned int direction_first = 0;
 	unsigned int direction_last = 2;
@@ -245,9 +258,13 @@ void write_planar_avg(const cube& potential_data, const cube& charge_data, const
 		direction_last = direction;
 	}
 
+	vector<vec> pot_sums(3), chg_sums(3);
+	tie(pot_sums[0], pot_sums[1], pot_sums[2]) = planar_sums(potential_data);
+	tie(chg_sums[0], chg_sums[1], chg_sums[2]) = planar_sums(charge_data);
+
 	for (unsigned int dir = direction_first; dir <= direction_last; ++dir) {
-		auto avg_pot = planar_average(dir, potential_data);
-		const auto avg_chg = planar_average(dir, charge_data);
+		vec avg_pot = pot_sums[dir];
+		const vec& avg_chg = chg_sums[dir];
 		const auto pot_normalization = static_cast<double>(avg_pot.n_elem) / potential_data.n_elem;
 		avg_pot *= pot_normalization;
 
@@ -271,6 +288,7 @@ void write_planar_avg(const cube& potential_data, const cube& charge_data, const
 }
 
 void check_slabcc_compatiblity(const supercell& Neutral_supercell, const supercell& Charged_supercell) {
+	const scoped_timer timer("check_slabcc_compatiblity");
 
 	auto log = spdlog::get("loggers");
 
@@ -280,8 +298,7 @@ void check_slabcc_compatiblity(const supercell& Neutral_supercell, const superce
 		log->debug("Neutral supercell vectors: " + to_string(Neutral_supercell.cell_vectors * Neutral_supercell.scaling));
 		log->debug("Charged supercell vectors: " + to_string(Charged_supercell.cell_vectors * Charged_supercell.scaling));
 		log->critical("Cell vectors of the input files does not match!");
-		finalize_loggers();
-		exit(1);
+		throw slabcc_error("Cell vectors of the input files does not match!");
 	}
 
 	//orthogonal
@@ -292,8 +309,7 @@ void check_slabcc_compatiblity(const supercell& Neutral_supercell, const superce
 		log->debug("Cell vectors basis: " + to_string(cell));
 		log->debug("Orthogonality criteria: " + to_string(cell.t() * cell));
 		log->critical("Supercell vectors are not orthogonal!");
-		finalize_loggers();
-		exit(1);
+		throw slabcc_error("Supercell vectors are not orthogonal!");
 	}
 
 	// equal grid
@@ -306,8 +322,7 @@ void check_slabcc_compatiblity(const supercell& Neutral_supercell, const superce
 		log->debug("Charged CHGCAR grid: " + to_string(arma::size(Charged_supercell.charge)));
 		log->debug("Charged LOCPOT grid: " + to_string(arma::size(Charged_supercell.potential)));
 		log->critical("Grid size of the data in CHGCAR/LOCPOT files does not match!");
-		finalize_loggers();
-		exit(1);
+		throw slabcc_error("Grid size of the data in CHGCAR/LOCPOT files does not match!");
 	}
 
 	log->trace("All files are loaded and cross-checked!");
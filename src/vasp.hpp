@@ -58,9 +58,15 @@ struct supercell {
 	cube potential;			//total potential (VASP LOCPOT * -1)
 
 
+	//generates an empty supercell
+	supercell() = default;
+
 	//generates a supercell and loads its data the POSCAR file
 	explicit supercell(const string& file_name);
 
+	//generates a supercell without any atoms with the cell_vectors (Ang) and zero-filled charge and potential grids
+	supercell(const mat33& cell_vectors, const urowvec3& grid);
+
 	//shifts the whole supercell (positions, charge, potential) by pos_shift as relative shift vector [0 1]
 	void shift(const rowvec3& pos_shift);
 